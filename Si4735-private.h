@@ -20,6 +20,47 @@
 #define SI4735_CP_READ1_GPO1 0xA0
 #define SI4735_CP_READ16_GPO1 0xE0
 
+//Define the longest argument list a Si47xx command can take; SPI writes
+//always clock out this many argument bytes after the command byte
+#define SI4735_CMD_MAXARGS 7
+
+//Define how much of the long response (status byte included) we need to read
+//back for the commands whose responses we actually parse; the chip always has
+//16 bytes ready but clocking out the ones we'd throw away is a waste of bus
+//time.
+#define SI4735_RSP_MAX 16
+#define SI4735_RSP_GET_REV 9
+#define SI4735_RSP_GET_PROPERTY 4
+#define SI4735_RSP_TUNE_STATUS 4
+#define SI4735_RSP_TUNE_STATUS_RSQ 6
+#define SI4735_RSP_RSQ_STATUS 8
+#define SI4735_RSP_RDS_STATUS 13
+
+//Define how long (in ms) to sleep on the GPO2 line waiting for a CTS
+//interrupt before double-checking the status byte anyway
+#define SI4735_CTS_POLL_INTERVAL 10
+
+//Define how many groups the RDS FIFO can hold, as per datasheet
+#define SI4735_RDS_FIFO_SIZE 25
+
+//Define how often (in ms) poll() checks on a tune or seek in progress when it
+//has no GPO2 interrupt to go by
+#define SI4735_STC_POLL_INTERVAL 20
+
+//Define how often (in ms) probePI() checks for a new block A
+#define SI4735_RDS_POLL_INTERVAL SI4735_CTS_POLL_INTERVAL
+
+//Define how much better (in dBuV) an AF's RSSI must be than the current one
+//for followAF() to try it
+#define SI4735_AF_MARGIN 6
+
+//Define how long (in ms) followAF() leaves a station alone after failing to
+//find a better AF for it
+#define SI4735_AF_RETRY_INTERVAL 5000
+
+//Define how long (in us) a SET_PROPERTY takes to settle, as per datasheet
+#define SI4735_PROP_SETTLE 10000
+
 //Define Si4735 I2C Addresses
 #define SI4735_I2C_ADDR_L (0x22 >> 1)
 #define SI4735_I2C_ADDR_H (0xC6 >> 1)
@@ -41,6 +82,80 @@
 #define SI4735_RDS_PTYNAB word(0x0010)
 #define SI4735_RDS_PTYN_ADDRESS word(0x0001)
 
+//Define the EEPROM station cache signature, change it whenever
+//Si4735_RDS_Station does
+#define SI4735_RDS_CACHE_MAGIC 0xA5
+
+//Define RDS slow labelling code (group 1A block C) and PIN (groups 1A/1B
+//block D) decoding masks
+#define SI4735_RDS_SLC_VARIANT_MASK 0x7000
+#define SI4735_RDS_SLC_VARIANT_SHR 12
+#define SI4735_RDS_SLC_DATA_MASK 0x0FFF
+#define SI4735_RDS_PIN_DAY_MASK 0xF800
+#define SI4735_RDS_PIN_DAY_SHR 11
+#define SI4735_RDS_PIN_HOUR_MASK 0x07C0
+#define SI4735_RDS_PIN_HOUR_SHR 6
+#define SI4735_RDS_PIN_MINUTE_MASK 0x003F
+
+//Define RDS AF (group 0A block C) codes: 1 to FM_MAX are FM frequencies,
+//NONE + 1 to COUNT_MAX head a list of that many AFs and LFMF says the next
+//code is an LF (1 to LF_MAX) or MF (LF_MAX + 1 to MF_MAX) frequency
+#define SI4735_RDS_AF_FM_MAX 204
+#define SI4735_RDS_AF_NONE 224
+#define SI4735_RDS_AF_COUNT_MAX 249
+#define SI4735_RDS_AF_LFMF 250
+#define SI4735_RDS_AF_LF_MAX 15
+#define SI4735_RDS_AF_MF_MAX 135
+
+//Define RDS EON (group 14A/14B) decoding masks and group 14A variants
+#define SI4735_RDS_EON_TP word(0x0010)
+#define SI4735_RDS_EON_TA word(0x0008)
+#define SI4735_RDS_EON_VARIANT word(0x000F)
+#define SI4735_RDS_EON_PTY_MASK 0xF800
+#define SI4735_RDS_EON_PTY_SHR 11
+#define SI4735_RDS_EON_TA_VAR13 word(0x0001)
+#define SI4735_EON_PS_LAST 3
+#define SI4735_EON_AF 4
+#define SI4735_EON_MAPPED_AM 9
+#define SI4735_EON_PTY_TA 13
+
+//Define RDS TMC (group 8A) decoding masks, as per ISO 14819-1
+#define SI4735_RDS_TMC_T word(0x0010)
+#define SI4735_RDS_TMC_F word(0x0008)
+#define SI4735_RDS_TMC_DPCI word(0x0007)
+#define SI4735_RDS_TMC_FIRST word(0x8000)
+#define SI4735_RDS_TMC_DIVERSION word(0x8000)
+#define SI4735_RDS_TMC_DIRECTION word(0x4000)
+#define SI4735_RDS_TMC_EXTENT_MASK 0x3800
+#define SI4735_RDS_TMC_EXTENT_SHR 11
+#define SI4735_RDS_TMC_EVENT_MASK 0x07FF
+#define SI4735_RDS_TMC_SECOND word(0x4000)
+#define SI4735_RDS_TMC_GSI_MASK 0x3000
+#define SI4735_RDS_TMC_GSI_SHR 12
+#define SI4735_RDS_TMC_CONTENT_MASK 0x0FFF
+
+//Define RDS ODA (group 3A) decoding masks and special group type codes
+#define SI4735_RDS_ODA_GROUP word(0x001F)
+#define SI4735_RDS_ODA_FAULT 0x1F
+
+//Define RT+ (ODA 4BD7) decoding masks and the content types we keep
+#define SI4735_RDS_AID_RTPLUS 0x4BD7
+#define SI4735_RDS_RTPLUS_TOGGLE word(0x0010)
+#define SI4735_RDS_RTPLUS_RUNNING word(0x0008)
+#define SI4735_RTPLUS_TYPE_TITLE 1
+#define SI4735_RTPLUS_TYPE_ALBUM 2
+#define SI4735_RTPLUS_TYPE_ARTIST 4
+#define SI4735_RTPLUS_TYPE_PROGRAMME 33
+
+//Define RBDS callsign PI ranges, as per NRSC-4-B Annex D
+#define SI4735_RBDS_K_FIRST 0x1000
+#define SI4735_RBDS_W_FIRST 0x54A8
+#define SI4735_RBDS_CALL3_FIRST 0x9950
+#define SI4735_RBDS_CALL3_LAST 0x99B9
+
+//Define where the country code sits in a PI
+#define SI4735_PI_COUNTRY_SHR 12
+
 //Define RDS CT (group 4A) decoding masks
 #define SI4735_RDS_TIME_TZ_OFFSET 0x0000001FUL
 #define SI4735_RDS_TIME_TZ_SIGN 0x00000020UL
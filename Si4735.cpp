@@ -19,20 +19,74 @@
 #if !defined(SI4735_NOI2C)
 # include <Wire.h>
 #endif
+#if defined(SI4735_RDS_CACHE_EEPROM)
+# include <EEPROM.h>
+#endif
 
-void Si4735RDSDecoder::decodeRDSBlock(word block[]){
-    byte grouptype;
+void Si4735RDSDecoder::decodeRDSBlock(word block[], byte errors){
+    byte grouptype, bleA, bleB, bleC, bleD, PTY, events = 0;
+    bool TP;
     word fourchars[2];
 
-    _status.programIdentifier = block[0];
+    bleA = SI4735_RDS_BLE(errors, 0);
+    bleB = SI4735_RDS_BLE(errors, 1);
+    bleC = SI4735_RDS_BLE(errors, 2);
+    bleD = SI4735_RDS_BLE(errors, 3);
+    //Without block B we don't even know what kind of group this is
+    if(bleB == SI4735_RDS_BLE_UNCORRECTABLE) return;
+
+    //A PI change wipes a lot, so take it only from a trustworthy block A
+    if(bleA <= SI4735_RDS_BLE_12 && block[0] != _status.programIdentifier) {
+        //AFs, EON and labels belong to the station that sent them
+        if(_afcount) {
+            resetAF();
+            events |= SI4735_RDS_EVENT_AF;
+        }
+#if SI4735_RDS_EON_MAX > 0
+        _eoncount = 0;
+        _eonevict = 0;
+        _eonlfmf = NULL;
+#endif
+        _havepin = false;
+        memset(_slc, 0x00, sizeof(_slc));
+        _slcseen = 0;
+        _status.programIdentifier = block[0];
+        events |= SI4735_RDS_EVENT_PI;
+        //Right after tuning, show what we knew of the station last time
+        if(!_pscomplete &&
+           touchStation(_aftuned, _status.programIdentifier)) {
+            memcpy(_status.programService, _cache[0].programService, 8);
+            memcpy(_status.programTypeName, _cache[0].programTypeName, 8);
+            events |= SI4735_RDS_EVENT_PS | SI4735_RDS_EVENT_PTYN;
+        }
+    }
     grouptype = lowByte((block[1] & SI4735_RDS_TYPE_MASK) >>
                         SI4735_RDS_TYPE_SHR);
-    _status.TP = block[1] & SI4735_RDS_TP;
-    _status.PTY = lowByte((block[1] & SI4735_RDS_PTY_MASK) >>
-                          SI4735_RDS_PTY_SHR);
+    TP = block[1] & SI4735_RDS_TP;
+    if(TP != _status.TP) {
+        _status.TP = TP;
+        events |= SI4735_RDS_EVENT_TATP;
+    }
+    PTY = lowByte((block[1] & SI4735_RDS_PTY_MASK) >> SI4735_RDS_PTY_SHR);
+    if(PTY != _status.PTY) {
+        _status.PTY = PTY;
+        events |= SI4735_RDS_EVENT_PTY;
+    }
 #if defined(SI4735_DEBUG)
     _rdsstats[grouptype]++;
 #endif
+#if SI4735_RDS_ODA_MAX > 0
+    word AID;
+
+    //Groups announced in 3A go to whoever registered for their AID first;
+    //0A can't carry ODA and its code means "3A only" in announcements
+    if(grouptype != SI4735_GROUP_0A && (AID = findODA(grouptype))) {
+        routeODA(AID, block, errors);
+        if(AID == SI4735_RDS_AID_RTPLUS && max(bleC, bleD) <= _maxblert &&
+           decodeRTPlus(block))
+            events |= SI4735_RDS_EVENT_RT;
+    }
+#endif
 
     switch(grouptype){
         case SI4735_GROUP_0A:
@@ -40,28 +94,74 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
         case SI4735_GROUP_15B:
             byte DIPSA;
             word twochars;
+            bool TA;
 
-            _status.TA = block[1] & SI4735_RDS_TA;
+            TA = block[1] & SI4735_RDS_TA;
+            if(TA != _status.TA) {
+                _status.TA = TA;
+                events |= SI4735_RDS_EVENT_TATP;
+            }
             _status.MS = block[1] & SI4735_RDS_MS;
             DIPSA = lowByte(block[1] & SI4735_RDS_DIPS_ADDRESS);
             bitWrite(_status.DICC, 3 - DIPSA, block[1] & SI4735_RDS_DI);
+            //Only version A has room for AFs, B repeats PI in block C
+            if(grouptype == SI4735_GROUP_0A && bleC <= _maxbleaf &&
+               decodeAF(highByte(block[2]), lowByte(block[2])))
+                events |= SI4735_RDS_EVENT_AF;
+            if(max(bleB, bleD) > _maxbleps) break;
             twochars = switchEndian(block[3]);
-            strncpy(&_status.programService[DIPSA * 2], (char *)&twochars, 2);
-            if(grouptype == SI4735_GROUP_0A) {
-                //TODO: read the standard and do AF list decoding
+            if(receiveText(&_psbuf[DIPSA * 2], &_psseen[DIPSA],
+                           (char *)&twochars, 2))
+                _psnew = true;
+            if(_psnew && isTextConfirmed(_psbuf, _psseen, 4, 2)) {
+                memcpy(_status.programService, _psbuf, 8);
+                makePrintable(_status.programService, 8);
+                _psnew = false;
+                _pscomplete = true;
+                storeStation();
+                events |= SI4735_RDS_EVENT_PS;
             }
             break;
         case SI4735_GROUP_1A:
         case SI4735_GROUP_1B:
-            //TODO: read the standard and do PIN and slow labeling codes
+            byte variant;
+
+            if(bleD <= _maxbleps) {
+                //Day 0 means the station sends no PIN
+                _havepin = block[3] & SI4735_RDS_PIN_DAY_MASK;
+                _pin.day = (block[3] & SI4735_RDS_PIN_DAY_MASK) >>
+                           SI4735_RDS_PIN_DAY_SHR;
+                _pin.hour = (block[3] & SI4735_RDS_PIN_HOUR_MASK) >>
+                            SI4735_RDS_PIN_HOUR_SHR;
+                _pin.minute = block[3] & SI4735_RDS_PIN_MINUTE_MASK;
+            }
+            //Only 1A has slow labelling codes, 1B repeats the PI instead
+            if(grouptype == SI4735_GROUP_1B || bleC > _maxbleps) break;
+            variant = lowByte((block[2] & SI4735_RDS_SLC_VARIANT_MASK) >>
+                              SI4735_RDS_SLC_VARIANT_SHR);
+            _slc[variant] = block[2] & SI4735_RDS_SLC_DATA_MASK;
+            _slcseen |= 1 << variant;
             break;
         case SI4735_GROUP_2A:
         case SI4735_GROUP_2B:
             byte RTA, RTAW;
 
-            if((block[1] & SI4735_RDS_TEXTAB) != _rdstextab) {
+            if(max(bleB, bleD) > _maxblert ||
+               (grouptype == SI4735_GROUP_2A && bleC > _maxblert))
+                break;
+            //A/B flipping means a new text is coming, start receiving it
+            //but keep showing the old one until the new one is confirmed
+            if((bool)(block[1] & SI4735_RDS_TEXTAB) != _rdstextab) {
                 _rdstextab = !_rdstextab;
-                memset(_status.radioText, ' ', 64);
+                memset(_rtbuf, ' ', 64);
+                memset(_rtseen, 0x00, sizeof(_rtseen));
+                _rtnew = true;
+#if SI4735_RDS_ODA_MAX > 0
+                //RT+ tags point into the old text, and so do the fields
+                //they picked out of it, bar the programme one
+                memset(_rtpluslength, 0x00, sizeof(_rtpluslength));
+                if(clearRTPlusItem()) events |= SI4735_RDS_EVENT_RT;
+#endif
             }
             RTA = lowByte(block[1] & SI4735_RDS_TEXT_ADDRESS);
             RTAW = (grouptype == SI4735_GROUP_2A) ? 4 : 2;
@@ -69,10 +169,29 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
                 block[(grouptype == SI4735_GROUP_2A) ? 2 : 3]);
             if(grouptype == SI4735_GROUP_2A)
                 fourchars[1] = switchEndian(block[3]);
-            strncpy(&_status.radioText[RTA * RTAW], (char *)fourchars, RTAW);
+            if(receiveText(&_rtbuf[RTA * RTAW], &_rtseen[RTA],
+                           (char *)fourchars, RTAW))
+                _rtnew = true;
+            if(_rtnew && isTextConfirmed(_rtbuf, _rtseen, 16, RTAW)) {
+                memcpy(_status.radioText, _rtbuf, 64);
+                _rtlength = makePrintable(_status.radioText, 64);
+                _status.radioText[_rtlength] = '\0';
+#if SI4735_RDS_ODA_MAX > 0
+                _rtshownab = _rdstextab;
+                updateRTPlus();
+#endif
+                _rtnew = false;
+                _rtcomplete = true;
+                events |= SI4735_RDS_EVENT_RT;
+            }
             break;
         case SI4735_GROUP_3A:
-            //TODO: read the standard and do AID listing
+#if SI4735_RDS_ODA_MAX > 0
+            //Block D carries the AID, don't go by a guess
+            if(bleD > SI4735_RDS_BLE_12) break;
+            registerODA(lowByte(block[1] & SI4735_RDS_ODA_GROUP), block[3]);
+            routeODA(block[3], block, errors);
+#endif
             break;
         case SI4735_GROUP_3B:
         case SI4735_GROUP_4B:
@@ -87,13 +206,14 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
         case SI4735_GROUP_12A:
         case SI4735_GROUP_12B:
         case SI4735_GROUP_13B:
-            //Application data payload (ODA), ignore for now
+            //Application data payload (ODA), routed above
             break;
         case SI4735_GROUP_4A:
             unsigned long MJD, CT, ys;
             word yp;
             byte k, mp;
 
+            if(max(bleB, max(bleC, bleD)) > _maxblect) break;
             CT = ((unsigned long)block[2] << 16) | block[3];
             //The standard mandates that CT must be all zeros if no time
             //information is being provided by the current station.
@@ -118,6 +238,7 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
             _time.tm_year = 1900 + yp + k;
             _time.tm_mon = mp - 1 - k * 12;
             _time.tm_wday = (MJD + 2) % 7 + 1;
+            events |= SI4735_RDS_EVENT_CT;
             break;
         case SI4735_GROUP_5A:
         case SI4735_GROUP_5B:
@@ -127,40 +248,64 @@ void Si4735RDSDecoder::decodeRDSBlock(word block[]){
             //TODO: read the standard and do Radio Paging
             break;
         case SI4735_GROUP_8A:
-            //TODO: read the standard and do TMC listing
+#if SI4735_RDS_TMC_MAX > 0
+            if(max(bleB, max(bleC, bleD)) > _maxbletmc) break;
+            decodeTMC(block);
+#endif
             break;
         case SI4735_GROUP_9A:
             //TODO: read the standard and do EWS listing
             break;
         case SI4735_GROUP_10A:
-            if((block[1] & SI4735_RDS_PTYNAB) != _rdsptynab) {
+            if(max(bleB, max(bleC, bleD)) > _maxbleps) break;
+            char* PTYN;
+
+            if((bool)(block[1] & SI4735_RDS_PTYNAB) != _rdsptynab) {
                 _rdsptynab = !_rdsptynab;
                 memset(_status.programTypeName, ' ', 8);
+                events |= SI4735_RDS_EVENT_PTYN;
             }
             fourchars[0] = switchEndian(block[2]);
             fourchars[1] = switchEndian(block[3]);
-            strncpy(&_status.programTypeName[(block[1] &
-                                              SI4735_RDS_PTYN_ADDRESS) * 4],
-                    (char *)&fourchars, 4);
+            makePrintable((char *)fourchars, 4);
+            PTYN = &_status.programTypeName[(block[1] &
+                                             SI4735_RDS_PTYN_ADDRESS) * 4];
+            if(memcmp(PTYN, fourchars, 4)) {
+                memcpy(PTYN, fourchars, 4);
+                if(_pscomplete) storeStation();
+                events |= SI4735_RDS_EVENT_PTYN;
+            }
             break;
         case SI4735_GROUP_13A:
             //TODO: read the standard and do Enhanced Radio Paging
             break;
         case SI4735_GROUP_14A:
         case SI4735_GROUP_14B:
-            //TODO: read the standard and do EON listing
+#if SI4735_RDS_EON_MAX > 0
+            //Block D carries PI(ON), everything hangs off it
+            if(bleD > _maxbleaf) break;
+            decodeEON(block, bleC);
+#endif
             break;
         case SI4735_GROUP_15A:
             //Withdrawn and currently unallocated, ignore
             break;
     }
+
+    _dirty |= events;
+    if(events && _eventcallback) _eventcallback(events);
 }
 
-void Si4735RDSDecoder::getRDSData(Si4735_RDS_Data* rdsdata){
-    makePrintable(_status.programService);
-    makePrintable(_status.programTypeName);
-    makePrintable(_status.radioText);
+void Si4735RDSDecoder::setBlockErrorLimits(byte PS, byte RT, byte CT,
+                                           byte AF, byte TMC){
+    _maxbleps = PS;
+    _maxblert = RT;
+    _maxblect = CT;
+    _maxbleaf = AF;
+    _maxbletmc = TMC;
+}
 
+void Si4735RDSDecoder::getRDSData(Si4735_RDS_Data* rdsdata){
     *rdsdata = _status;
 }
 
@@ -170,30 +315,597 @@ bool Si4735RDSDecoder::getRDSTime(Si4735_RDS_Time* rdstime){
     return _havect;
 }
 
-void Si4735RDSDecoder::resetRDS(void){
+bool Si4735RDSDecoder::getPIN(Si4735_RDS_PIN* pin){
+    if(_havepin && pin) *pin = _pin;
+
+    return _havepin;
+}
+
+bool Si4735RDSDecoder::getSlowLabel(byte variant, word* data){
+    if(!(_slcseen & (1 << variant))) return false;
+    if(data) *data = _slc[variant];
+
+    return true;
+}
+
+#if SI4735_RDS_TMC_MAX > 0
+bool Si4735RDSDecoder::getTMCMessage(Si4735_TMC_Message* message){
+    if(!_tmccount) return false;
+
+    *message = _tmc[_tmchead];
+    _tmchead = (_tmchead + 1) % SI4735_RDS_TMC_MAX;
+    _tmccount--;
+
+    return true;
+}
+#endif
+
+#if SI4735_RDS_ODA_MAX > 0
+bool Si4735RDSDecoder::setODAHandler(word AID,
+                                     Si4735_RDS_ODA_Handler handler){
+    byte i;
+
+    for(i = 0; i < _odahandlers; i++)
+        if(_odaaid[i] == AID) break;
+
+    if(!handler) {
+        //Fill the hole with the last one, order doesn't matter
+        if(i < _odahandlers) {
+            _odahandlers--;
+            _odaaid[i] = _odaaid[_odahandlers];
+            _odahandler[i] = _odahandler[_odahandlers];
+        }
+        return true;
+    }
+    if(i == _odahandlers) {
+        if(_odahandlers == SI4735_RDS_ODA_HANDLERS) return false;
+        _odaaid[_odahandlers++] = AID;
+    }
+    _odahandler[i] = handler;
+
+    return true;
+}
+#endif
+
+word Si4735RDSDecoder::getAF(byte index, bool* regional){
+    if(index >= _afcount) return 0;
+    if(regional) *regional = bitRead(_afregional, index);
+
+    return _af[index];
+}
+
+void Si4735RDSDecoder::resetRDS(word frequency){
     memset(_status.programService, ' ', 8);
     _status.programService[8] = '\0';
     memset(_status.programTypeName, ' ', 8);
     _status.programTypeName[8] = '\0';
     memset(_status.radioText, ' ', 64);
     _status.radioText[64] = '\0';
+    _rtlength = 64;
+    memset(_psbuf, ' ', 8);
+    memset(_psseen, 0x00, sizeof(_psseen));
+    memset(_rtbuf, ' ', 64);
+    memset(_rtseen, 0x00, sizeof(_rtseen));
+    _pscomplete = false;
+    _rtcomplete = false;
+    //Even a blank text needs publishing once confirmed
+    _psnew = true;
+    _rtnew = true;
+    _status.programIdentifier = 0x0000;
+    _status.TP = false;
+    _status.TA = false;
+    _status.MS = false;
+    _status.PTY = 0;
     _status.DICC = 0;
     _rdstextab = false;
     _rdsptynab = false;
     _havect = false;
+    _havepin = false;
+    memset(_slc, 0x00, sizeof(_slc));
+    _slcseen = 0;
+    _aftuned = frequency;
+    resetAF();
+#if SI4735_RDS_EON_MAX > 0
+    _eoncount = 0;
+    _eonevict = 0;
+    _eonlfmf = NULL;
+#endif
+#if SI4735_RDS_TMC_MAX > 0
+    _tmccount = 0;
+    _tmchead = 0;
+    _tmcassembling = false;
+    memset(_tmclast, 0x00, sizeof(_tmclast));
+#endif
+#if SI4735_RDS_ODA_MAX > 0
+    _odacount = 0;
+    _odaevict = 0;
+    for(byte i = 0; i < SI4735_RTPLUS_FIELDS; i++) _rtplus[i][0] = '\0';
+    memset(_rtpluslength, 0x00, sizeof(_rtpluslength));
+    _rtplustoggle = false;
+    _rtplusrunning = false;
+    _rtshownab = false;
+#endif
+    _dirty = SI4735_RDS_EVENT_PI | SI4735_RDS_EVENT_PS | SI4735_RDS_EVENT_RT |
+             SI4735_RDS_EVENT_TATP | SI4735_RDS_EVENT_PTY |
+             SI4735_RDS_EVENT_PTYN | SI4735_RDS_EVENT_AF;
 #if defined(SI4735_DEBUG)
     memset((void *)&_rdsstats, 0x00, sizeof(_rdsstats));
 #endif
 }
 
-void Si4735RDSDecoder::makePrintable(char* str){
-    for(byte i = 0; i < strlen(str); i++) {
-        if(str[i] == 0x0D) {
-            str[i] = '\0';
+bool Si4735RDSDecoder::receiveText(char* buffer, byte* seen,
+                                   const char* chars, byte length){
+    if(memcmp(buffer, chars, length)) {
+        memcpy(buffer, chars, length);
+        *seen = 1;
+
+        return true;
+    }
+    if(*seen < SI4735_RDS_CONFIRM) (*seen)++;
+
+    return false;
+}
+
+bool Si4735RDSDecoder::isTextConfirmed(const char* buffer, const byte* seen,
+                                       byte count, byte length){
+    for(byte i = 0; i < count; i++) {
+        if(seen[i] < SI4735_RDS_CONFIRM) return false;
+        //RadioText may end early, with a CR
+        if(memchr(&buffer[i * length], 0x0D, length)) break;
+    }
+
+    return true;
+}
+
+bool Si4735RDSDecoder::decodeAF(byte first, byte second){
+    byte codes[2] = {first, second};
+    bool changed = false;
+
+    if(first > SI4735_RDS_AF_NONE && first <= SI4735_RDS_AF_COUNT_MAX) {
+        //A list header: the number of AFs, then the first of them (with
+        //method B, the frequency the list is for)
+        _aflfmf = (second == SI4735_RDS_AF_LFMF);
+        if(_afheader && second != _afheader) {
+            //Only method B sends more than one list: keep the one for the
+            //frequency we're on if we know it, else the first one seen
+            _afmethodb = true;
+            _aflist = false;
+            if(_aftuned && AFToFrequency(second, false) == _aftuned &&
+               AFToFrequency(_afheader, false) != _aftuned) {
+                resetAF();
+                _afmethodb = true;
+                _aflist = true;
+                _afheader = second;
+                changed = true;
+            } else return false;
+        } else {
+            _aflist = true;
+            if(second <= SI4735_RDS_AF_FM_MAX) _afheader = second;
+        }
+
+        return addAF(AFToFrequency(second, false), false) || changed;
+    }
+    //Pairs are only meaningful once we know which list they belong to
+    if(!_aflist) return false;
+
+    if(!_aflfmf && _afheader &&
+       (first == _afheader || second == _afheader)) {
+        //Method B: each pair is the frequency the list is for and one AF,
+        //in ascending order unless the AF carries a regional variant
+        _afmethodb = true;
+
+        return addAF(AFToFrequency(first == _afheader ? second : first,
+                                   false), first > second);
+    }
+
+    //Method A: just a stream of frequencies
+    for(byte i = 0; i < 2; i++)
+        if(_aflfmf) {
+            changed |= addAF(AFToFrequency(codes[i], true), false);
+            _aflfmf = false;
+        } else if(codes[i] == SI4735_RDS_AF_LFMF) _aflfmf = true;
+        else changed |= addAF(AFToFrequency(codes[i], false), false);
+
+    return changed;
+}
+
+bool Si4735RDSDecoder::addAF(word frequency, bool regional){
+    byte i;
+
+    if(!frequency) return false;
+    for(i = 0; i < _afcount; i++)
+        if(_af[i] == frequency) {
+            if(bitRead(_afregional, i) == regional) return false;
+            bitWrite(_afregional, i, regional);
+
+            return true;
+        }
+    if(_afcount == SI4735_RDS_AF_MAX) return false;
+    _af[_afcount++] = frequency;
+    bitWrite(_afregional, i, regional);
+
+    return true;
+}
+
+void Si4735RDSDecoder::resetAF(void){
+    _afcount = 0;
+    _afregional = 0;
+    _afheader = 0;
+    _afmethodb = false;
+    _aflist = false;
+    _aflfmf = false;
+}
+
+word Si4735RDSDecoder::AFToFrequency(byte code, bool lfmf){
+    if(lfmf) {
+        if(code >= 1 && code <= SI4735_RDS_AF_LF_MAX)
+            return 153 + (code - 1) * 9;
+        if(code > SI4735_RDS_AF_LF_MAX && code <= SI4735_RDS_AF_MF_MAX)
+            return 531 + (code - SI4735_RDS_AF_LF_MAX - 1) * 9;
+    } else if(code >= 1 && code <= SI4735_RDS_AF_FM_MAX)
+        return 8750 + code * 10;
+
+    return 0;
+}
+
+#if SI4735_RDS_EON_MAX > 0
+void Si4735RDSDecoder::decodeEON(word block[], byte bleC){
+    Si4735_RDS_EON* network;
+    word AF[2] = {0, 0}, twochars;
+    byte variant, j, codes[2];
+    bool TA;
+
+    network = findEON(block[3]);
+    network->TP = block[1] & SI4735_RDS_EON_TP;
+    TA = network->TA;
+    if(lowByte((block[1] & SI4735_RDS_TYPE_MASK) >> SI4735_RDS_TYPE_SHR) ==
+       SI4735_GROUP_14B)
+        //14B is only ever sent to announce a TA(ON) change
+        TA = block[1] & SI4735_RDS_EON_TA;
+    else {
+        variant = lowByte(block[1] & SI4735_RDS_EON_VARIANT);
+        if(variant <= SI4735_EON_PS_LAST) {
+            if(bleC > _maxbleps) return;
+            twochars = switchEndian(block[2]);
+            memcpy(&network->programService[variant * 2], &twochars, 2);
+            makePrintable(&network->programService[variant * 2], 2);
+        } else if(variant == SI4735_EON_PTY_TA) {
+            if(bleC > _maxbleps) return;
+            network->PTY = lowByte((block[2] & SI4735_RDS_EON_PTY_MASK) >>
+                                   SI4735_RDS_EON_PTY_SHR);
+            TA = block[2] & SI4735_RDS_EON_TA_VAR13;
+        } else if(variant <= SI4735_EON_MAPPED_AM) {
+            if(bleC > _maxbleaf) return;
+            if(variant == SI4735_EON_AF) {
+                //AF(ON) is sent like a method A list, minus the headers,
+                //and may split an LF/MF filler from its code across groups
+                codes[0] = highByte(block[2]);
+                codes[1] = lowByte(block[2]);
+                for(byte i = 0; i < 2; i++)
+                    if(_eonlfmf == network) {
+                        AF[i] = AFToFrequency(codes[i], true);
+                        _eonlfmf = NULL;
+                    } else if(codes[i] == SI4735_RDS_AF_LFMF)
+                        _eonlfmf = network;
+                    else AF[i] = AFToFrequency(codes[i], false);
+            } else if(!_aftuned ||
+                      AFToFrequency(highByte(block[2]), false) == _aftuned)
+                //Mapped frequencies: where to find the other network when
+                //we're tuned to the frequency in the high byte
+                AF[0] = AFToFrequency(lowByte(block[2]),
+                                      variant == SI4735_EON_MAPPED_AM);
+            for(byte i = 0; i < 2; i++) {
+                if(!AF[i]) continue;
+                for(j = 0; j < network->AFCount; j++)
+                    if(network->AF[j] == AF[i]) break;
+                if(j == network->AFCount && j < SI4735_RDS_EON_AF_MAX)
+                    network->AF[network->AFCount++] = AF[i];
+            }
+        }
+    }
+    if(TA != network->TA) {
+        network->TA = TA;
+        if(_eoncallback) _eoncallback(network);
+    }
+}
+
+Si4735_RDS_EON* Si4735RDSDecoder::findEON(word PI){
+    Si4735_RDS_EON* network;
+
+    for(byte i = 0; i < _eoncount; i++)
+        if(_eon[i].programIdentifier == PI) return &_eon[i];
+
+    if(_eoncount < SI4735_RDS_EON_MAX) network = &_eon[_eoncount++];
+    else {
+        network = &_eon[_eonevict];
+        _eonevict = (_eonevict + 1) % SI4735_RDS_EON_MAX;
+        if(_eonlfmf == network) _eonlfmf = NULL;
+    }
+    network->programIdentifier = PI;
+    network->TP = false;
+    network->TA = false;
+    network->PTY = 0;
+    memset(network->programService, ' ', 8);
+    network->programService[8] = '\0';
+    network->AFCount = 0;
+
+    return network;
+}
+#endif
+
+#if SI4735_RDS_TMC_MAX > 0
+void Si4735RDSDecoder::decodeTMC(word block[]){
+    Si4735_TMC_Message single;
+    Si4735_TMC_Message* message;
+    byte GSI;
+
+    //Every group is sent at least twice in a row, once is enough for us
+    if(!memcmp(_tmclast, &block[1], sizeof(_tmclast))) return;
+    memcpy(_tmclast, &block[1], sizeof(_tmclast));
+    //Tuning and service information, not messages
+    if(block[1] & SI4735_RDS_TMC_T) return;
+
+    if(block[1] & SI4735_RDS_TMC_F || block[2] & SI4735_RDS_TMC_FIRST) {
+        //Single group messages and the first group of multi-group ones
+        //share the same layout, bar the flags
+        message = (block[1] & SI4735_RDS_TMC_F) ? &single : &_tmcmessage;
+        message->event = block[2] & SI4735_RDS_TMC_EVENT_MASK;
+        message->location = block[3];
+        message->extent = lowByte((block[2] & SI4735_RDS_TMC_EXTENT_MASK) >>
+                                  SI4735_RDS_TMC_EXTENT_SHR);
+        message->direction = block[2] & SI4735_RDS_TMC_DIRECTION;
+        message->groups = 1;
+        //Optional content only comes with later groups, if at all
+        memset(message->content, 0x00, sizeof(message->content));
+        if(message == &single) {
+            single.diversion = block[2] & SI4735_RDS_TMC_DIVERSION;
+            single.duration = lowByte(block[1] & SI4735_RDS_TMC_DPCI);
+            queueTMC(&single);
+        } else {
+            _tmcmessage.diversion = false;
+            _tmcmessage.duration = 0;
+            _tmcci = lowByte(block[1] & SI4735_RDS_TMC_DPCI);
+            _tmcassembling = true;
+        }
+        return;
+    }
+
+    //The rest of a multi-group message: same continuity index, the second
+    //group flagged as such and the group sequence counting down to 0
+    if(!_tmcassembling ||
+       lowByte(block[1] & SI4735_RDS_TMC_DPCI) != _tmcci)
+        return;
+    GSI = lowByte((block[2] & SI4735_RDS_TMC_GSI_MASK) >>
+                  SI4735_RDS_TMC_GSI_SHR);
+    if((block[2] & SI4735_RDS_TMC_SECOND) ?
+       _tmcmessage.groups != 1 :
+       (_tmcmessage.groups == 1 || GSI != _tmcgsi - 1)) {
+        //We missed a group, drop the whole message
+        _tmcassembling = false;
+        return;
+    }
+    _tmcmessage.content[_tmcmessage.groups++ - 1] =
+        ((unsigned long)(block[2] & SI4735_RDS_TMC_CONTENT_MASK) << 16) |
+        block[3];
+    _tmcgsi = GSI;
+    if(!GSI) {
+        _tmcassembling = false;
+        queueTMC(&_tmcmessage);
+    }
+}
+
+void Si4735RDSDecoder::queueTMC(const Si4735_TMC_Message* message){
+    Si4735_TMC_Message* queued;
+
+    //A repeat of a message still waiting is an update, not news
+    for(byte i = 0; i < _tmccount; i++) {
+        queued = &_tmc[(_tmchead + i) % SI4735_RDS_TMC_MAX];
+        if(queued->event == message->event &&
+           queued->location == message->location &&
+           queued->direction == message->direction &&
+           queued->extent == message->extent) {
+            *queued = *message;
+            return;
+        }
+    }
+
+    if(_tmccount == SI4735_RDS_TMC_MAX) {
+        _tmchead = (_tmchead + 1) % SI4735_RDS_TMC_MAX;
+        _tmccount--;
+    }
+    _tmc[(_tmchead + _tmccount++) % SI4735_RDS_TMC_MAX] = *message;
+}
+#endif
+
+#if SI4735_RDS_ODA_MAX > 0
+void Si4735RDSDecoder::registerODA(byte group, word AID){
+    byte i;
+
+    //Not an announcement, the encoder is telling us it has a problem
+    if(group == SI4735_RDS_ODA_FAULT) return;
+
+    //Group types can only carry one ODA at a time; 3A-only ones can only be
+    //told apart by AID
+    for(i = 0; i < _odacount; i++)
+        if(group ? _oda[i].group == group :
+                   !_oda[i].group && _oda[i].AID == AID)
             break;
+    if(i == _odacount) {
+        if(_odacount < SI4735_RDS_ODA_MAX) i = _odacount++;
+        else {
+            i = _odaevict;
+            _odaevict = (_odaevict + 1) % SI4735_RDS_ODA_MAX;
         }
-        if(str[i] < 32 || str[i] > 126) str[i] = '?';
+        _oda[i].group = group;
+    }
+    _oda[i].AID = AID;
+}
+
+word Si4735RDSDecoder::findODA(byte group){
+    for(byte i = 0; i < _odacount; i++)
+        if(_oda[i].group == group) return _oda[i].AID;
+
+    return 0x0000;
+}
+
+void Si4735RDSDecoder::routeODA(word AID, word block[], byte errors){
+    for(byte i = 0; i < _odahandlers; i++)
+        if(_odaaid[i] == AID) _odahandler[i](AID, block, errors);
+}
+#endif
+
+bool Si4735RDSDecoder::touchStation(word frequency, word PI){
+    Si4735_RDS_Station station;
+
+    for(byte i = 0; i < _cachecount; i++)
+        if(_cache[i].frequency == frequency &&
+           _cache[i].programIdentifier == PI) {
+            station = _cache[i];
+            memmove(&_cache[1], &_cache[0], i * sizeof(_cache[0]));
+            _cache[0] = station;
+            return true;
+        }
+
+    return false;
+}
+
+void Si4735RDSDecoder::storeStation(void){
+    if(!_status.programIdentifier) return;
+
+    if(!touchStation(_aftuned, _status.programIdentifier)) {
+        //Make room at the front, dropping the least recently used if full
+        if(_cachecount < SI4735_RDS_CACHE_MAX) _cachecount++;
+        memmove(&_cache[1], &_cache[0],
+                (_cachecount - 1) * sizeof(_cache[0]));
+        _cache[0].frequency = _aftuned;
+        _cache[0].programIdentifier = _status.programIdentifier;
     }
+    memcpy(_cache[0].programService, _status.programService, 8);
+    memcpy(_cache[0].programTypeName, _status.programTypeName, 8);
+}
+
+#if defined(SI4735_RDS_CACHE_EEPROM)
+void Si4735RDSDecoder::loadStationCache(void){
+    int address = SI4735_RDS_CACHE_EEPROM;
+    byte count;
+
+    if(EEPROM.read(address++) != SI4735_RDS_CACHE_MAGIC) return;
+    count = EEPROM.read(address++);
+    if(count > SI4735_RDS_CACHE_MAX) return;
+    for(word i = 0; i < count * sizeof(_cache[0]); i++)
+        ((byte *)_cache)[i] = EEPROM.read(address++);
+    _cachecount = count;
+}
+
+void Si4735RDSDecoder::saveStationCache(void){
+    int address = SI4735_RDS_CACHE_EEPROM;
+    byte header[2] = {SI4735_RDS_CACHE_MAGIC, _cachecount};
+
+    //Rewrite only what changed, each write wears the cell out a bit
+    for(byte i = 0; i < sizeof(header); i++, address++)
+        if(EEPROM.read(address) != header[i])
+            EEPROM.write(address, header[i]);
+    for(word i = 0; i < _cachecount * sizeof(_cache[0]); i++, address++)
+        if(EEPROM.read(address) != ((byte *)_cache)[i])
+            EEPROM.write(address, ((byte *)_cache)[i]);
+}
+#endif
+
+#if SI4735_RDS_ODA_MAX > 0
+bool Si4735RDSDecoder::decodeRTPlus(word block[]){
+    byte type[2], start[2], length[2], field;
+    bool toggle, changed = false;
+
+    toggle = block[1] & SI4735_RDS_RTPLUS_TOGGLE;
+    if(toggle != _rtplustoggle) {
+        //A new item started, what we knew about the last one is history
+        _rtplustoggle = toggle;
+        changed = clearRTPlusItem();
+    }
+    _rtplusrunning = block[1] & SI4735_RDS_RTPLUS_RUNNING;
+
+    //Two tags of content type (6 bits), start (6 bits) and length minus
+    //one (6 bits, 5 for the second tag), packed from block B bit 2 on
+    type[0] = lowByte(((block[1] & 0x0007) << 3) | (block[2] >> 13));
+    start[0] = lowByte((block[2] >> 7) & 0x003F);
+    length[0] = lowByte((block[2] >> 1) & 0x003F);
+    type[1] = lowByte(((block[2] & 0x0001) << 5) | (block[3] >> 11));
+    start[1] = lowByte((block[3] >> 5) & 0x003F);
+    length[1] = lowByte(block[3] & 0x001F);
+    for(byte i = 0; i < 2; i++) {
+        switch(type[i]){
+            case SI4735_RTPLUS_TYPE_TITLE:
+                field = SI4735_RTPLUS_TITLE;
+                break;
+            case SI4735_RTPLUS_TYPE_ARTIST:
+                field = SI4735_RTPLUS_ARTIST;
+                break;
+            case SI4735_RTPLUS_TYPE_ALBUM:
+                field = SI4735_RTPLUS_ALBUM;
+                break;
+            case SI4735_RTPLUS_TYPE_PROGRAMME:
+                field = SI4735_RTPLUS_PROGRAMME;
+                break;
+            default:
+                continue;
+        }
+        _rtplusstart[field] = start[i];
+        _rtpluslength[field] = length[i] + 1;
+    }
+
+    //Tags sent after an A/B flip describe a text we aren't showing yet,
+    //they'll be applied once it is
+    if(_rdstextab == _rtshownab && updateRTPlus()) changed = true;
+
+    return changed;
+}
+
+bool Si4735RDSDecoder::clearRTPlusItem(void){
+    bool changed = false;
+
+    for(byte field = SI4735_RTPLUS_TITLE; field <= SI4735_RTPLUS_ALBUM;
+        field++) {
+        if(_rtplus[field][0]) changed = true;
+        _rtplus[field][0] = '\0';
+        _rtpluslength[field] = 0;
+    }
+
+    return changed;
+}
+
+bool Si4735RDSDecoder::updateRTPlus(void){
+    byte length;
+    bool changed = false;
+
+    for(byte field = 0; field < SI4735_RTPLUS_FIELDS; field++) {
+        if(!_rtpluslength[field] ||
+           _rtplusstart[field] + _rtpluslength[field] > 64)
+            continue;
+        length = min(_rtpluslength[field], SI4735_RDS_RTPLUS_LENGTH);
+        if(strlen(_rtplus[field]) == length &&
+           !memcmp(_rtplus[field], &_status.radioText[_rtplusstart[field]],
+                   length))
+            continue;
+        memcpy(_rtplus[field], &_status.radioText[_rtplusstart[field]],
+               length);
+        _rtplus[field][length] = '\0';
+        changed = true;
+    }
+
+    return changed;
+}
+#endif
+
+byte Si4735RDSDecoder::makePrintable(char* str, byte length){
+    byte end = length;
+
+    for(byte i = 0; i < length; i++) {
+        if(end == length && str[i] == 0x0D) end = i;
+        if(i >= end) str[i] = ' ';
+        else if(str[i] < 32 || str[i] > 126) str[i] = '?';
+    }
+
+    return end;
 }
 
 #if defined(SI4735_DEBUG)
@@ -356,29 +1068,217 @@ byte Si4735Translate::translatePTY(byte PTY, byte fromlocale, byte tolocale){
     return 0;
 }
 
-void Si4735Translate::decodeCallSign(word programIdentifier, char* callSign){
-    //TODO: read the standard and implement world-wide PI decoding
-    if(programIdentifier >= 21672){
+//RBDS three-letter callsigns (PI - SI4735_RBDS_CALL3_FIRST, then the
+//letters), as per NRSC-4-B Annex D; sorted, so the lookup can stop early
+const char Si4735_RBDS_CallSign3[][4] PROGMEM = {
+    {0x00, 'K', 'E', 'X'}, {0x01, 'K', 'F', 'H'}, {0x02, 'K', 'F', 'I'},
+    {0x03, 'K', 'G', 'A'}, {0x04, 'K', 'G', 'O'}, {0x05, 'K', 'G', 'U'},
+    {0x06, 'K', 'G', 'W'}, {0x07, 'K', 'G', 'Y'}, {0x08, 'K', 'I', 'D'},
+    {0x09, 'K', 'I', 'T'}, {0x0A, 'K', 'J', 'R'}, {0x0B, 'K', 'L', 'O'},
+    {0x0C, 'K', 'L', 'Z'}, {0x0D, 'K', 'M', 'A'}, {0x0E, 'K', 'M', 'J'},
+    {0x0F, 'K', 'N', 'X'}, {0x10, 'K', 'O', 'A'}, {0x14, 'K', 'Q', 'V'},
+    {0x15, 'K', 'S', 'L'}, {0x16, 'K', 'U', 'J'}, {0x17, 'K', 'V', 'I'},
+    {0x18, 'K', 'W', 'G'}, {0x1B, 'K', 'Y', 'W'}, {0x1D, 'W', 'B', 'Z'},
+    {0x1E, 'W', 'D', 'Z'}, {0x1F, 'W', 'E', 'W'}, {0x21, 'W', 'G', 'L'},
+    {0x22, 'W', 'G', 'N'}, {0x23, 'W', 'G', 'R'}, {0x25, 'W', 'H', 'A'},
+    {0x26, 'W', 'H', 'B'}, {0x27, 'W', 'H', 'K'}, {0x28, 'W', 'H', 'O'},
+    {0x2A, 'W', 'I', 'P'}, {0x2B, 'W', 'J', 'R'}, {0x2C, 'W', 'K', 'Y'},
+    {0x2D, 'W', 'L', 'S'}, {0x2E, 'W', 'L', 'W'}, {0x31, 'W', 'O', 'C'},
+    {0x33, 'W', 'O', 'L'}, {0x34, 'W', 'O', 'R'}, {0x38, 'W', 'W', 'J'},
+    {0x39, 'W', 'W', 'L'}, {0x40, 'K', 'D', 'B'}, {0x41, 'K', 'G', 'B'},
+    {0x42, 'K', 'O', 'Y'}, {0x43, 'K', 'P', 'Q'}, {0x44, 'K', 'S', 'D'},
+    {0x45, 'K', 'U', 'T'}, {0x46, 'K', 'X', 'L'}, {0x47, 'K', 'X', 'O'},
+    {0x49, 'W', 'B', 'T'}, {0x4A, 'W', 'G', 'H'}, {0x4B, 'W', 'G', 'Y'},
+    {0x4C, 'W', 'H', 'P'}, {0x4D, 'W', 'I', 'L'}, {0x4E, 'W', 'M', 'C'},
+    {0x4F, 'W', 'M', 'T'}, {0x50, 'W', 'O', 'I'}, {0x51, 'W', 'O', 'W'},
+    {0x52, 'W', 'R', 'R'}, {0x53, 'W', 'S', 'B'}, {0x54, 'W', 'S', 'M'},
+    {0x55, 'K', 'B', 'W'}, {0x56, 'K', 'C', 'Y'}, {0x57, 'K', 'D', 'F'},
+    {0x5A, 'K', 'H', 'Q'}, {0x5B, 'K', 'O', 'B'}, {0x63, 'W', 'I', 'S'},
+    {0x64, 'W', 'J', 'W'}, {0x65, 'W', 'J', 'Z'}, {0x69, 'W', 'R', 'C'}};
+
+//Countries by ECC (first byte of each row) and PI country code 1 to F, as
+//per IEC 62106 Annex D; ISO 3166 codes, blanks where none is allocated.
+//Only Europe and North America for now, add rows as needed.
+const char Si4735_ECC2Country[][32] PROGMEM = {
+    "\xE0" "DEDZADILITBERUPSALATHUMTDE  EG",
+    "\xE1" "GRCYSMCHJOFILUBGDKGIIQGBLYROFR",
+    "\xE2" "MACZPLVASKSYTN  LIISMCLTRSESNO",
+    "\xE3" "MEIETRMK      NLLVLBAZHRKZSEBY",
+    "\xE4" "MDEEKG    UA  PTSIAMUZGE  TMBA",
+    "\xA0" "USUSUSUSUSUSUSUSUSUSUS  USUS  ",
+    "\xA1" "                    CACACACAGL"};
+
+bool Si4735Translate::decodeCallSign(word programIdentifier, char* callSign){
+    //AFxy and Axyz are compressed forms of xy00 and x0yz
+    if((programIdentifier & 0xFF00) == 0xAF00) programIdentifier <<= 8;
+    else if((programIdentifier & 0xF000) == 0xA000)
+        programIdentifier = ((programIdentifier & 0x0F00) << 4) |
+                            (programIdentifier & 0x00FF);
+
+    if(programIdentifier >= SI4735_RBDS_K_FIRST &&
+       programIdentifier < SI4735_RBDS_W_FIRST) {
+        callSign[0] = 'K';
+        programIdentifier -= SI4735_RBDS_K_FIRST;
+    } else if(programIdentifier >= SI4735_RBDS_W_FIRST &&
+              programIdentifier < SI4735_RBDS_CALL3_FIRST) {
         callSign[0] = 'W';
-        programIdentifier -= 21672;
-    } else
-        if(programIdentifier < 21672 && programIdentifier >= 0x1000){
-            callSign[0] = 'K';
-            programIdentifier -= 0x1000;
-        } else programIdentifier -= 1;
-    if(programIdentifier >= 0){
-        callSign[1] = char(programIdentifier / 676 + 'A');
-        callSign[2] = char((programIdentifier - 676 * programIdentifier /
-                            676) / 26 + 'A');
-        callSign[3] = char(((programIdentifier - 676 * programIdentifier /
-                             676) % 26 ) + 'A');
-        callSign[4] = '\0';
-    } else strcpy(callSign, "UNKN");
+        programIdentifier -= SI4735_RBDS_W_FIRST;
+    } else {
+        byte offset;
+
+        if(programIdentifier >= SI4735_RBDS_CALL3_FIRST &&
+           programIdentifier <= SI4735_RBDS_CALL3_LAST)
+            for(byte i = 0; i < sizeof(Si4735_RBDS_CallSign3) /
+                                sizeof(Si4735_RBDS_CallSign3[0]); i++) {
+                offset = pgm_read_byte(&Si4735_RBDS_CallSign3[i][0]);
+                if(offset > programIdentifier - SI4735_RBDS_CALL3_FIRST)
+                    break;
+                if(offset == programIdentifier - SI4735_RBDS_CALL3_FIRST) {
+                    strncpy_P(callSign, &Si4735_RBDS_CallSign3[i][1], 3);
+                    callSign[3] = '\0';
+                    return true;
+                }
+            }
+        //Network, regional or otherwise not callsign-derived code
+        strcpy(callSign, "UNKN");
+        return false;
+    }
+    callSign[1] = char(programIdentifier / 676 + 'A');
+    callSign[2] = char((programIdentifier % 676) / 26 + 'A');
+    callSign[3] = char(programIdentifier % 26 + 'A');
+    callSign[4] = '\0';
+
+    return true;
 }
 
+bool Si4735Translate::decodeCountry(word programIdentifier, byte ECC,
+                                    char* country){
+    byte code;
+
+    code = programIdentifier >> SI4735_PI_COUNTRY_SHR;
+    if(code)
+        for(byte i = 0; i < sizeof(Si4735_ECC2Country) /
+                            sizeof(Si4735_ECC2Country[0]); i++)
+            if(pgm_read_byte(&Si4735_ECC2Country[i][0]) == ECC) {
+                strncpy_P(country, &Si4735_ECC2Country[i][code * 2 - 1], 2);
+                country[2] = '\0';
+                if(country[0] != ' ') return true;
+                break;
+            }
+    country[0] = '\0';
+
+    return false;
+}
+
+//Built-in property profiles, see Si4735.h
+const Si4735_Property Si4735_Profile_Stereo[] PROGMEM = {
+    {SI4735_PROP_FM_BLEND_STEREO_THRESHOLD, 0},
+    {SI4735_PROP_FM_BLEND_MONO_THRESHOLD, 0},
+    {SI4735_PROP_FM_BLEND_RSSI_STEREO_THRESHOLD, 0},
+    {SI4735_PROP_FM_BLEND_RSSI_MONO_THRESHOLD, 0},
+    //Per AN332
+    {SI4735_PROP_FM_BLEND_SNR_STEREO_THRESHOLD, 0},
+    {SI4735_PROP_FM_BLEND_SNR_MONO_THRESHOLD, 0},
+    {SI4735_PROP_FM_BLEND_MULTIPATH_STEREO_THRESHOLD, 100},
+    {SI4735_PROP_FM_BLEND_MULTIPATH_MONO_THRESHOLD, 100},
+    SI4735_PROFILE_END
+};
+
+const Si4735_Property Si4735_Profile_Mono[] PROGMEM = {
+    {SI4735_PROP_FM_BLEND_STEREO_THRESHOLD, 127},
+    {SI4735_PROP_FM_BLEND_MONO_THRESHOLD, 127},
+    {SI4735_PROP_FM_BLEND_RSSI_STEREO_THRESHOLD, 127},
+    {SI4735_PROP_FM_BLEND_RSSI_MONO_THRESHOLD, 127},
+    //Per AN332
+    {SI4735_PROP_FM_BLEND_SNR_STEREO_THRESHOLD, 0},
+    {SI4735_PROP_FM_BLEND_SNR_MONO_THRESHOLD, 0},
+    {SI4735_PROP_FM_BLEND_MULTIPATH_STEREO_THRESHOLD, 100},
+    {SI4735_PROP_FM_BLEND_MULTIPATH_MONO_THRESHOLD, 100},
+    SI4735_PROFILE_END
+};
+
+const Si4735_Property Si4735_Profile_RDS[] PROGMEM = {
+    {SI4735_PROP_FM_RDS_INT_SOURCE, SI4735_FLG_RDSRECV},
+    {SI4735_PROP_FM_RDS_CONFIG, (SI4735_FLG_BLETHA_35 | SI4735_FLG_BLETHB_35 |
+                                 SI4735_FLG_BLETHC_35 |
+                                 SI4735_FLG_BLETHD_35) << 8 |
+                                SI4735_FLG_RDSEN},
+    SI4735_PROFILE_END
+};
+
+const Si4735_Property Si4735_Profile_SW[] PROGMEM = {
+    //2.3 MHz
+    {SI4735_PROP_AM_SEEK_BAND_BOTTOM, 0x08FC},
+    //23 MHz
+    {SI4735_PROP_AM_SEEK_BAND_TOP, 0x59D8},
+    SI4735_PROFILE_END
+};
+
+const Si4735_Property Si4735_Profile_LW[] PROGMEM = {
+    //152 kHz
+    {SI4735_PROP_AM_SEEK_BAND_BOTTOM, 0x0099},
+    //279 kHz
+    {SI4735_PROP_AM_SEEK_BAND_TOP, 0x0117},
+    SI4735_PROFILE_END
+};
+
+//Argument count of every command we know about, as per the Si4735
+//Programmers Guide. Anything not listed here gets the full 7 bytes.
+const byte Si4735_CMD_Args[][2] PROGMEM = {
+    {SI4735_CMD_POWER_UP, 2},
+    {SI4735_CMD_GET_REV, 0},
+    {SI4735_CMD_POWER_DOWN, 0},
+    {SI4735_CMD_SET_PROPERTY, 5},
+    {SI4735_CMD_GET_PROPERTY, 3},
+    {SI4735_CMD_GET_INT_STATUS, 0},
+    {SI4735_CMD_PATCH_ARGS, 7},
+    {SI4735_CMD_PATCH_DATA, 7},
+    {SI4735_CMD_FM_TUNE_FREQ, 4},
+    {SI4735_CMD_FM_SEEK_START, 1},
+    {SI4735_CMD_FM_TUNE_STATUS, 1},
+    {SI4735_CMD_FM_RSQ_STATUS, 1},
+    {SI4735_CMD_FM_RDS_STATUS, 1},
+    {SI4735_CMD_FM_AGC_STATUS, 0},
+    {SI4735_CMD_FM_AGC_OVERRIDE, 2},
+    {SI4735_CMD_TX_TUNE_FREQ, 3},
+    {SI4735_CMD_TX_TUNE_POWER, 4},
+    {SI4735_CMD_TX_TUNE_MEASURE, 4},
+    {SI4735_CMD_TX_TUNE_STATUS, 1},
+    {SI4735_CMD_TX_ASQ_STATUS, 1},
+    {SI4735_CMD_TX_RDS_BUF, 7},
+    {SI4735_CMD_TX_RDS_PS, 5},
+    {SI4735_CMD_AM_TUNE_FREQ, 5},
+    {SI4735_CMD_AM_SEEK_START, 5},
+    {SI4735_CMD_AM_TUNE_STATUS, 1},
+    {SI4735_CMD_AM_RSQ_STATUS, 1},
+    {SI4735_CMD_AM_AGC_STATUS, 0},
+    {SI4735_CMD_AM_AGC_OVERRIDE, 2},
+    {SI4735_CMD_WB_TUNE_FREQ, 3},
+    {SI4735_CMD_WB_TUNE_STATUS, 1},
+    {SI4735_CMD_WB_RSQ_STATUS, 1},
+    {SI4735_CMD_WB_SAME_STATUS, 2},
+    {SI4735_CMD_WB_ASQ_STATUS, 1},
+    {SI4735_CMD_WB_AGC_STATUS, 0},
+    {SI4735_CMD_WB_AGC_OVERRIDE, 1},
+    {SI4735_CMD_AUX_ASQ_STATUS, 1},
+    {SI4735_CMD_GPIO_CTL, 1},
+    {SI4735_CMD_GPIO_SET, 1}};
+
+volatile bool Si4735::_gpo2int = false;
+
 Si4735::Si4735(byte interface, byte pinPower, byte pinReset, byte pinGPO2,
                byte pinSEN){
     _mode = SI4735_MODE_FM;
+    _ctsint = false;
+    _propsettling = false;
+    _propcount = 0;
+    _propevict = 0;
+    _tuning = false;
+    _seeking = false;
+    _afwait = false;
+    _rdsthreshold = 1;
+    _tunecallback = NULL;
+    _seekcallback = NULL;
     _pinPower = pinPower;
     _pinReset = pinReset;
     _pinGPO2 = pinGPO2;
@@ -470,46 +1370,53 @@ void Si4735::begin(byte mode, bool xosc, bool slowshifter){
     setMode(mode, false, xosc);
 }
 
+bool Si4735::setCTSInterrupt(bool enable){
+    if(_ctsint && !enable)
+        detachInterrupt(digitalPinToInterrupt(_pinGPO2));
+    //No point in asking for interrupts if we can't hear them
+    _ctsint = enable && _pinGPO2 != SI4735_PIN_GPO2_HW &&
+              digitalPinToInterrupt(_pinGPO2) != NOT_AN_INTERRUPT;
+
+    return _ctsint;
+}
+
 void Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3,
                          byte arg4, byte arg5, byte arg6, byte arg7){
+    byte args[SI4735_CMD_MAXARGS] = {arg1, arg2, arg3, arg4, arg5, arg6, arg7};
+
+    //SPI frames get padded to full length anyway (see sendCommandArgs()),
+    //but argc must be the real one for the property cache to see writes
+    sendCommandArgs(command, args, getArgumentCount(command));
+}
+
+void Si4735::sendCommandArgs(byte command, const byte* args, byte argc){
     byte status;
 
+    if(argc > SI4735_CMD_MAXARGS) argc = SI4735_CMD_MAXARGS;
+    //Anything but another property write may depend on the last one having
+    //taken effect, so that's when we need to let it settle.
+    if(command != SI4735_CMD_SET_PROPERTY) waitForProperty();
+
 #if defined(SI4735_DEBUG)
     Serial.print("Si4735 CMD 0x");
     Serial.print(command, HEX);
-    Serial.print(" (0x");
-    Serial.print(arg1, HEX);
-    Serial.print(" [");
-    Serial.print(arg1, BIN);
-    Serial.print("], 0x");
-    Serial.print(arg2, HEX);
-    Serial.print(" [");
-    Serial.print(arg2, BIN);
-    Serial.print("], 0x");
-    Serial.print(arg3, HEX);
-    Serial.print(" [");
-    Serial.print(arg3, BIN);
-    Serial.println("],");
-    Serial.print("0x");
-    Serial.print(arg4, HEX);
-    Serial.print(" [");
-    Serial.print(arg4, BIN);
-    Serial.print("], 0x");
-    Serial.print(arg5, HEX);
-    Serial.print(" [");
-    Serial.print(arg5, BIN);
-    Serial.print("], 0x");
-    Serial.print(arg6, HEX);
-    Serial.print(" [");
-    Serial.print(arg6, BIN);
-    Serial.print("], 0x");
-    Serial.print(arg7, HEX);
-    Serial.print(" [");
-    Serial.print(arg7, BIN);
-    Serial.println("])");
+    Serial.print(" (");
+    for(byte i = 0; i < argc; i++) {
+        if(i == 3) Serial.println(",");
+        else if(i) Serial.print(", ");
+        Serial.print("0x");
+        Serial.print(args[i], HEX);
+        Serial.print(" [");
+        Serial.print(args[i], BIN);
+        Serial.print("]");
+    }
+    Serial.println(")");
     Serial.flush();
 #endif
 
+    //Forget about any edge seen so far, CTS for this command is yet to come
+    _gpo2int = false;
+
     if(!_i2caddr) {
 #if !defined(SI4735_NOSPI)
         digitalWrite(_pinSEN, LOW);
@@ -517,13 +1424,10 @@ void Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3,
         delayMicroseconds(5);
         SPI.transfer(SI4735_CP_WRITE8);
         SPI.transfer(command);
-        SPI.transfer(arg1);
-        SPI.transfer(arg2);
-        SPI.transfer(arg3);
-        SPI.transfer(arg4);
-        SPI.transfer(arg5);
-        SPI.transfer(arg6);
-        SPI.transfer(arg7);
+        //The SPI write preamble promises the chip exactly 8 bytes, so pad
+        //whatever arguments we don't have with zeros.
+        for(byte i = 0; i < SI4735_CMD_MAXARGS; i++)
+            SPI.transfer((i < argc) ? args[i] : 0x00);
         //Datahseet calls for 5ns, Arduino can only go as low as 3us
         delayMicroseconds(5);
         digitalWrite(_pinSEN, HIGH);
@@ -532,13 +1436,7 @@ void Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3,
 #if !defined(SI4735_NOI2C)
         Wire.beginTransmission(_i2caddr);
         Wire.write(command);
-        Wire.write(arg1);
-        Wire.write(arg2);
-        Wire.write(arg3);
-        Wire.write(arg4);
-        Wire.write(arg5);
-        Wire.write(arg6);
-        Wire.write(arg7);
+        if(argc) Wire.write(args, argc);
         Wire.endTransmission();
 #endif
     };
@@ -549,32 +1447,84 @@ void Si4735::sendCommand(byte command, byte arg1, byte arg2, byte arg3,
     //Furthermore, the datasheet specifically mandates waiting for CTS to come
     //back up before doing anything else, *including* attempting to read back
     //the response from the last command sent.
-    //Therefore, we poll for CTS coming back up after we send the command.
+    //Therefore, we wait for CTS coming back up after we send the command.
+    status = waitForCTS();
+
+    //Keep the property cache in sync with whatever reaches the chip, no
+    //matter if it came through setProperty() or straight from the user.
+    switch(command){
+        case SI4735_CMD_POWER_UP:
+        case SI4735_CMD_POWER_DOWN:
+            //All properties go back to their defaults across a power cycle
+            _propcount = 0;
+            _propevict = 0;
+            break;
+        case SI4735_CMD_SET_PROPERTY:
+            if(argc >= 5 && !(status & SI4735_STATUS_ERR))
+                cacheProperty(word(args[1], args[2]), word(args[3], args[4]));
+            break;
+    }
+}
+
+byte Si4735::waitForCTS(void){
+    unsigned long start;
+    byte status;
+
     do {
+        if(_ctsint) {
+            //Sleep on GPO2 instead of hogging the bus. The line is shared
+            //with STC and RDS interrupts so an edge is merely a hint and we
+            //still confirm it with a status read; likewise, we don't trust
+            //an edge to come forever and go check anyway every now and then.
+            start = millis();
+            while(!_gpo2int && (millis() - start) < SI4735_CTS_POLL_INTERVAL);
+            _gpo2int = false;
+        }
         status = getStatus();
     } while(!(status & SI4735_STATUS_CTS));
+
+    return status;
+}
+
+void Si4735::waitForProperty(void){
+    unsigned long elapsed;
+
+    if(!_propsettling) return;
+    elapsed = micros() - _propset;
+    if(elapsed < SI4735_PROP_SETTLE)
+        delayMicroseconds(SI4735_PROP_SETTLE - elapsed);
+    _propsettling = false;
 }
 
 void Si4735::setFrequency(word frequency){
+    startTune(frequency);
+    completeTune();
+}
+
+void Si4735::startTune(word frequency, bool fast){
     switch(_mode){
         case SI4735_MODE_FM:
-            sendCommand(SI4735_CMD_FM_TUNE_FREQ, 0x00, highByte(frequency),
+            sendCommand(SI4735_CMD_FM_TUNE_FREQ,
+                        (fast ? SI4735_FLG_FAST : 0x00), highByte(frequency),
                         lowByte(frequency));
             break;
         case SI4735_MODE_AM:
         case SI4735_MODE_SW:
         case SI4735_MODE_LW:
-            sendCommand(SI4735_CMD_AM_TUNE_FREQ, 0x00, highByte(frequency),
+            sendCommand(SI4735_CMD_AM_TUNE_FREQ,
+                        (fast ? SI4735_FLG_FAST : 0x00), highByte(frequency),
                         lowByte(frequency), 0x00,
                         ((_mode == SI4735_MODE_SW) ? 0x01 : 0x00));
             break;
     }
-    completeTune();
+    _tuning = true;
+    _seeking = false;
+    _tunepoll = millis();
 }
 
 byte Si4735::getRevision(char* FW, char* CMP, char* REV, word* patch){
     sendCommand(SI4735_CMD_GET_REV);
-    getResponse(_response);
+    getResponse(_response, SI4735_RSP_GET_REV);
 
     if(FW) {
         FW[0] = _response[2];
@@ -605,7 +1555,7 @@ word Si4735::getFrequency(bool* valid){
             sendCommand(SI4735_CMD_AM_TUNE_STATUS);
             break;
     }
-    getResponse(_response);
+    getResponse(_response, SI4735_RSP_TUNE_STATUS);
     frequency = word(_response[2], _response[3]);
 
     if(valid) *valid = (_response[1] & SI4735_STATUS_VALID);
@@ -613,39 +1563,211 @@ word Si4735::getFrequency(bool* valid){
 }
 
 void Si4735::seekUp(bool wrap){
+    startSeek(true, wrap);
+    completeTune();
+}
+
+void Si4735::seekDown(bool wrap){
+    startSeek(false, wrap);
+    completeTune();
+}
+
+void Si4735::startSeek(bool up, bool wrap){
     switch(_mode){
         case SI4735_MODE_FM:
             sendCommand(SI4735_CMD_FM_SEEK_START,
-                        (SI4735_FLG_SEEKUP |
+                        ((up ? SI4735_FLG_SEEKUP : 0x00) |
                          (wrap ? SI4735_FLG_WRAP : 0x00)));
             break;
         case SI4735_MODE_AM:
         case SI4735_MODE_SW:
         case SI4735_MODE_LW:
             sendCommand(SI4735_CMD_AM_SEEK_START,
-                        (SI4735_FLG_SEEKUP | (wrap ? SI4735_FLG_WRAP : 0x00)),
-                        0x00, 0x00, 0x00,
+                        ((up ? SI4735_FLG_SEEKUP : 0x00) |
+                         (wrap ? SI4735_FLG_WRAP : 0x00)), 0x00, 0x00, 0x00,
                         ((_mode == SI4735_MODE_SW) ? 0x01 : 0x00));
             break;
     }
-    completeTune();
+    _tuning = true;
+    _seeking = true;
+    _tunepoll = millis();
 }
 
-void Si4735::seekDown(bool wrap){
+bool Si4735::poll(void){
+    if(!_tuning) return false;
+
+    //Don't hog the bus asking the same question over and over: STCINT also
+    //pulls GPO2 low, so if we're listening for that just wait for the edge
+    if(!_gpo2int && (millis() - _tunepoll) < SI4735_STC_POLL_INTERVAL)
+        return true;
+    _tunepoll = millis();
+
+    sendCommand(SI4735_CMD_GET_INT_STATUS);
+    if(getStatus() & SI4735_STATUS_STCINT) {
+        finishTune();
+        return false;
+    }
+
+    if(_seeking && _seekcallback) {
+        //TUNE_STATUS without INTACK tells us where the seek has got to
+        switch(_mode){
+            case SI4735_MODE_FM:
+                sendCommand(SI4735_CMD_FM_TUNE_STATUS);
+                break;
+            case SI4735_MODE_AM:
+            case SI4735_MODE_SW:
+            case SI4735_MODE_LW:
+                sendCommand(SI4735_CMD_AM_TUNE_STATUS);
+                break;
+        }
+        getResponse(_response, SI4735_RSP_TUNE_STATUS_RSQ);
+        _seekcallback(word(_response[2], _response[3]), _response[4]);
+    }
+
+    //The seek callback may have cancelled the seek
+    return _tuning;
+}
+
+void Si4735::cancelSeek(void){
+    if(!_seeking) return;
+
     switch(_mode){
         case SI4735_MODE_FM:
-            sendCommand(SI4735_CMD_FM_SEEK_START,
-                        (wrap ? SI4735_FLG_WRAP : 0x00));
+            sendCommand(SI4735_CMD_FM_TUNE_STATUS, SI4735_FLG_CANCEL);
             break;
         case SI4735_MODE_AM:
         case SI4735_MODE_SW:
         case SI4735_MODE_LW:
-            sendCommand(SI4735_CMD_AM_SEEK_START,
-                        (wrap ? SI4735_FLG_WRAP : 0x00), 0x00, 0x00, 0x00,
-                        ((_mode == SI4735_MODE_SW) ? 0x01 : 0x00));
+            sendCommand(SI4735_CMD_AM_TUNE_STATUS, SI4735_FLG_CANCEL);
             break;
     }
-    completeTune();
+    //Cancelling raises STC like a normal end of seek would, clear it the same
+    //way
+    finishTune();
+}
+
+byte Si4735::scanBand(Si4735_Scan_Result* stations, byte size,
+                      unsigned long* duration){
+    unsigned long started;
+    byte count = 0;
+
+    if(!size) return 0;
+
+    started = millis();
+    //Start from the bottom of the band and seek up without wrapping, the
+    //chip then tells us (BLTF) when we've gone all the way round
+    startTune(getProperty((_mode == SI4735_MODE_FM) ?
+                          SI4735_PROP_FM_SEEK_BAND_BOTTOM :
+                          SI4735_PROP_AM_SEEK_BAND_BOTTOM));
+    while(true) {
+        waitForSTC();
+        getResponse(_response, SI4735_RSP_TUNE_STATUS_RSQ);
+        stations[count].frequency = word(_response[2], _response[3]);
+        stations[count].RSSI = _response[4];
+        stations[count].SNR = _response[5];
+        stations[count].valid = (_response[1] & SI4735_STATUS_VALID);
+        count++;
+
+        if((_response[1] & SI4735_STATUS_BLTF) || count == size) break;
+        startSeek(true, false);
+    }
+    _tuning = false;
+    _seeking = false;
+    if(_mode == SI4735_MODE_FM) enableRDS();
+
+    if(duration) *duration = millis() - started;
+    return count;
+}
+
+void Si4735::sweepBand(word start, word stop, word step,
+                       Si4735_SweepCallback callback){
+    word frequency;
+
+    if(!callback || !step || start > stop) return;
+
+    frequency = start;
+    while(true) {
+        startTune(frequency, true);
+        waitForSTC();
+        //TUNE_STATUS doesn't measure anything useful after a FAST tune
+        switch(_mode){
+            case SI4735_MODE_FM:
+                sendCommand(SI4735_CMD_FM_RSQ_STATUS);
+                break;
+            case SI4735_MODE_AM:
+            case SI4735_MODE_SW:
+            case SI4735_MODE_LW:
+                sendCommand(SI4735_CMD_AM_RSQ_STATUS);
+                break;
+        }
+        getResponse(_response, SI4735_RSP_RSQ_STATUS);
+        callback(frequency, _response[4], _response[5]);
+
+        //Mind the wrap around at the top of a word
+        if(stop - frequency < step) break;
+        frequency += step;
+    }
+    _tuning = false;
+}
+
+bool Si4735::followAF(Si4735RDSDecoder* decoder, byte RSSI, byte SNR,
+                      word dwell){
+    Si4735_RX_Metrics current, candidate;
+    unsigned long started;
+    word PI, found, home, bottom, top, frequency, muted;
+    bool regional, moved = false;
+
+    //Only FM has RDS (and AFs), and don't get in the way of a tune or seek
+    if(_mode != SI4735_MODE_FM || _tuning || !decoder->getAFCount())
+        return false;
+    PI = decoder->getPI();
+    if(!PI) return false;
+    if(_afwait && (millis() - _afsearch) < SI4735_AF_RETRY_INTERVAL)
+        return false;
+    getRSQ(&current);
+    if(current.RSSI >= RSSI && current.SNR >= SNR) return false;
+
+    started = millis();
+    home = getFrequency();
+    bottom = getProperty(SI4735_PROP_FM_SEEK_BAND_BOTTOM);
+    top = getProperty(SI4735_PROP_FM_SEEK_BAND_TOP);
+    muted = getProperty(SI4735_PROP_RX_HARD_MUTE);
+    mute();
+    for(byte i = 0; i < decoder->getAFCount(); i++) {
+        if(millis() - started >= dwell) break;
+        frequency = decoder->getAF(i, &regional);
+        //Regional variants aren't the same programme and LW/MW AFs (or
+        //ones outside the band) are no use to us
+        if(regional || frequency == home || frequency < bottom ||
+           frequency > top)
+            continue;
+        startTune(frequency, true);
+        waitForSTC();
+        getRSQ(&candidate);
+        if(candidate.RSSI < current.RSSI + SI4735_AF_MARGIN ||
+           candidate.SNR < SNR)
+            continue;
+        if(probePI(&found, dwell - min(dwell, millis() - started)) &&
+           found == PI) {
+            moved = true;
+            break;
+        }
+    }
+    if(!moved) {
+        startTune(home, true);
+        waitForSTC();
+    }
+    _tuning = false;
+    setProperty(SI4735_PROP_RX_HARD_MUTE, muted);
+    _afwait = !moved;
+    _afsearch = millis();
+    if(moved) {
+        //Same programme, so keep what was received on home
+        decoder->setTunedFrequency(frequency);
+        if(_tunecallback) _tunecallback(frequency, true);
+    }
+
+    return moved;
 }
 
 void Si4735::setSeekThresholds(byte SNR, byte RSSI){
@@ -667,23 +1789,87 @@ void Si4735::setSeekThresholds(byte SNR, byte RSSI){
     }
 }
 
-bool Si4735::readRDSBlock(word* block){
+bool Si4735::readRDSBlock(word* block, byte* errors){
     //See if there's anything for us to do
     if(!(_mode == SI4735_MODE_FM && (getStatus() & SI4735_STATUS_RDSINT)))
         return false;
 
     _haverds = true;
+    fetchRDSGroup(block, errors);
+
+    return true;
+}
+
+byte Si4735::readRDSGroups(word groups[][4], byte size, byte* errors){
+    byte count = 0, left;
+
+    //See if there's anything for us to do
+    if(!(size && _mode == SI4735_MODE_FM &&
+         (getStatus() & SI4735_STATUS_RDSINT)))
+        return 0;
+
+    _haverds = true;
+    //Keep going for as long as the chip says there's more
+    do left = fetchRDSGroup(groups[count], errors ? &errors[count] : NULL);
+    while(++count < size && left);
+
+    return count;
+}
+
+void Si4735::setRDSThreshold(byte count){
+    _rdsthreshold = constrain(count, 1, SI4735_RDS_FIFO_SIZE);
+    if(_mode == SI4735_MODE_FM)
+        setProperty(SI4735_PROP_FM_RDS_INT_FIFO_COUNT,
+                    word(0x00, _rdsthreshold));
+}
+
+byte Si4735::fetchRDSGroup(word* block, byte* errors){
     //Grab the next available RDS group from the chip
     sendCommand(SI4735_CMD_FM_RDS_STATUS, SI4735_FLG_INTACK);
-    getResponse(_response);
+    getResponse(_response, SI4735_RSP_RDS_STATUS);
     //memcpy() would be faster but it won't help since we're of a different
     //endianness than the device we're talking to.
     block[0] = word(_response[4], _response[5]);
     block[1] = word(_response[6], _response[7]);
     block[2] = word(_response[8], _response[9]);
     block[3] = word(_response[10], _response[11]);
+    if(errors) *errors = _response[12];
 
-    return true;
+    return _response[3];
+}
+
+bool Si4735::probePI(word* PI, word timeout){
+    unsigned long started;
+    word block[4];
+    byte errors;
+
+    if(_mode != SI4735_MODE_FM) return false;
+    started = millis();
+    //Anything already in the FIFO (or flagged) came from before the tune
+    sendCommand(SI4735_CMD_FM_RDS_STATUS,
+                SI4735_FLG_MTFIFO | SI4735_FLG_INTACK);
+    while(millis() - started < timeout) {
+        //A block A only comes every 88ms, don't hog the bus meanwhile
+        delay(SI4735_RDS_POLL_INTERVAL);
+        //Peek without popping, the decoder will want these groups too
+        sendCommand(SI4735_CMD_FM_RDS_STATUS, SI4735_FLG_STATUSONLY);
+        getResponse(_response, SI4735_RSP_RDS_STATUS);
+        if(!(_response[2] & SI4735_STATUS_RDSSYNC)) continue;
+        if(_response[1] & SI4735_FLG_RDSNEWBLOCKA) {
+            //The last block A seen, no need to wait for the rest of it
+            block[0] = word(_response[4], _response[5]);
+            errors = _response[12];
+        } else if(_response[3])
+            //Firmware that doesn't flag block As, take a whole group
+            fetchRDSGroup(block, &errors);
+        else continue;
+        if(SI4735_RDS_BLE(errors, 0) <= SI4735_RDS_BLE_12) {
+            *PI = block[0];
+            return true;
+        }
+    }
+
+    return false;
 }
 
 void Si4735::getRSQ(Si4735_RX_Metrics* RSQ){
@@ -698,7 +1884,7 @@ void Si4735::getRSQ(Si4735_RX_Metrics* RSQ){
             break;
     }
     //Now read the response
-    getResponse(_response);
+    getResponse(_response, SI4735_RSP_RSQ_STATUS);
 
     //Pull the response data into their respecive fields
     RSQ->RSSI = _response[4];
@@ -765,22 +1951,25 @@ byte Si4735::getStatus(void){
     return response;
 }
 
-void Si4735::getResponse(byte* response){
+void Si4735::getResponse(byte* response, byte length){
+    if(length > SI4735_RSP_MAX) length = SI4735_RSP_MAX;
+
     if(!_i2caddr) {
 #if !defined(SI4735_NOSPI)
         digitalWrite(_pinSEN, LOW);
         //Datasheet calls for 30ns, Arduino can only go as low as 3us
         delayMicroseconds(5);
         SPI.transfer(SI4735_CP_READ16_GPO1);
-        for(int i = 0; i < 16; i++) response[i] = SPI.transfer(0x00);
+        //The chip doesn't mind us raising SEN before all 16 bytes are out
+        for(byte i = 0; i < length; i++) response[i] = SPI.transfer(0x00);
         //Datahseet calls for 5ns, Arduino can only go as low as 3us
         delayMicroseconds(5);
         digitalWrite(_pinSEN, HIGH);
 #endif
     } else {
 #if !defined(SI4735_NOI2C)
-        Wire.requestFrom((uint8_t)_i2caddr, (uint8_t)16);
-        for(int i = 0; i < 16; i++) {
+        Wire.requestFrom((uint8_t)_i2caddr, (uint8_t)length);
+        for(byte i = 0; i < length; i++) {
             //I2C runs at 100kHz when using the Wire library, 100kHz = 10us
             //period so wait 10 bit-times for something to become available.
             while(!Wire.available()) delayMicroseconds(100);
@@ -791,20 +1980,18 @@ void Si4735::getResponse(byte* response){
 
 #if defined(SI4735_DEBUG)
     Serial.print("Si4735 RSP");
-    for(int i = 0; i < 4; i++) {
-        if(i) Serial.print("           ");
-        else Serial.print(" ");
-        for(int j = 0; j < 4; j++) {
-            Serial.print("0x");
-            Serial.print(response[i * 4 + j], HEX);
-            Serial.print(" [");
-            Serial.print(response[i * 4 + j], BIN);
-            Serial.print("]");
-            if(j != 3) Serial.print(", ");
-            else
-                if(i != 3) Serial.print(",");
+    for(byte i = 0; i < length; i++) {
+        if(!(i % 4)) Serial.print(i ? "           " : " ");
+        Serial.print("0x");
+        Serial.print(response[i], HEX);
+        Serial.print(" [");
+        Serial.print(response[i], BIN);
+        Serial.print("]");
+        if(i % 4 != 3 && i != length - 1) Serial.print(", ");
+        else {
+            if(i != length - 1) Serial.print(",");
+            Serial.println("");
         }
-        Serial.println("");
     }
     Serial.flush();
 #endif
@@ -812,7 +1999,10 @@ void Si4735::getResponse(byte* response){
 
 void Si4735::end(bool hardoff){
     sendCommand(SI4735_CMD_POWER_DOWN);
+    _tuning = false;
+    _seeking = false;
     if(hardoff) {
+        if(_ctsint) detachInterrupt(digitalPinToInterrupt(_pinGPO2));
         //datasheet calls for 10ns, Arduino can only go as low as 3us
         delayMicroseconds(5);
 #if !defined(SI4735_NOSPI)
@@ -840,11 +2030,17 @@ void Si4735::setMode(byte mode, bool powerdown, bool xosc){
     if(powerdown) end(false);
     _mode = mode;
 
+    //Listen for GPO2 edges before the chip starts making them
+    if(_ctsint)
+        attachInterrupt(digitalPinToInterrupt(_pinGPO2), handleGPO2,
+                        FALLING);
+
     switch(_mode){
         case SI4735_MODE_FM:
             sendCommand(SI4735_CMD_POWER_UP,
                         ((_pinGPO2 == SI4735_PIN_GPO2_HW) ? 0x00 :
                          SI4735_FLG_GPO2IEN) |
+                        (_ctsint ? SI4735_FLG_CTSIEN : 0x00) |
                         (xosc ? SI4735_FLG_XOSCEN : 0x00) | SI4735_FUNC_FM,
                         SI4735_OUT_ANALOG);
             break;
@@ -854,6 +2050,7 @@ void Si4735::setMode(byte mode, bool powerdown, bool xosc){
             sendCommand(SI4735_CMD_POWER_UP,
                         ((_pinGPO2 == SI4735_PIN_GPO2_HW) ? 0x00 :
                          SI4735_FLG_GPO2IEN) |
+                        (_ctsint ? SI4735_FLG_CTSIEN : 0x00) |
                         (xosc ? SI4735_FLG_XOSCEN : 0x00) | SI4735_FUNC_AM,
                         SI4735_OUT_ANALOG);
             break;
@@ -875,16 +2072,10 @@ void Si4735::setMode(byte mode, bool powerdown, bool xosc){
     //Set the seek band for the desired mode (AM and FM can use defaults)
     switch(_mode){
         case SI4735_MODE_SW:
-            //Set the lower band limit for Short Wave Radio to 2.3 MHz
-            setProperty(SI4735_PROP_AM_SEEK_BAND_BOTTOM, 0x08FC);
-            //Set the upper band limit for Short Wave Radio to 23 MHz
-            setProperty(SI4735_PROP_AM_SEEK_BAND_TOP, 0x59D8);
+            setProperties(Si4735_Profile_SW);
             break;
         case SI4735_MODE_LW:
-            //Set the lower band limit for Long Wave Radio to 152 kHz
-            setProperty(SI4735_PROP_AM_SEEK_BAND_BOTTOM, 0x0099);
-            //Set the upper band limit for Long Wave Radio to 279 kHz
-            setProperty(SI4735_PROP_AM_SEEK_BAND_BOTTOM, 0x0117);
+            setProperties(Si4735_Profile_LW);
             break;
     }
 
@@ -898,43 +2089,111 @@ void Si4735::setMode(byte mode, bool powerdown, bool xosc){
 }
 
 void Si4735::setProperty(word property, word value){
+    byte i;
+
+    //Don't bother the chip with what it already knows
+    i = findCachedProperty(property);
+    if(i != SI4735_PROPERTY_CACHE && _propcache[i][1] == value) return;
+
     sendCommand(SI4735_CMD_SET_PROPERTY, 0x00, highByte(property),
                 lowByte(property), highByte(value), lowByte(value));
     //Datasheet states SET_PROPERTY completes 10ms after sending the command
-    //irrespective of CTS coming up earlier than that
-    delay(10);
+    //irrespective of CTS coming up earlier than that. Rather than sitting
+    //here, remember when that is and only wait if somebody needs us sooner.
+    _propset = micros();
+    _propsettling = true;
+}
+
+void Si4735::setProperties(const Si4735_Property* profile){
+    word property;
+
+    //Back-to-back SET_PROPERTY commands don't wait on each other's settle
+    //time (see sendCommandArgs()), so the whole profile settles at once
+    while((property = pgm_read_word(&profile->property))) {
+        setProperty(property, pgm_read_word(&profile->value));
+        profile++;
+    }
 }
 
 word Si4735::getProperty(word property){
+    byte i;
+    word value;
+
+    i = findCachedProperty(property);
+    if(i != SI4735_PROPERTY_CACHE) return _propcache[i][1];
+
     sendCommand(SI4735_CMD_GET_PROPERTY, 0x00, highByte(property),
                 lowByte(property));
-    getResponse(_response);
+    getResponse(_response, SI4735_RSP_GET_PROPERTY);
+    value = word(_response[2], _response[3]);
+    if(!(_response[0] & SI4735_STATUS_ERR)) cacheProperty(property, value);
+
+    return value;
+}
+
+byte Si4735::findCachedProperty(word property){
+    for(byte i = 0; i < _propcount; i++)
+        if(_propcache[i][0] == property) return i;
+
+    return SI4735_PROPERTY_CACHE;
+}
+
+void Si4735::cacheProperty(word property, word value){
+    byte i;
 
-    return word(_response[2], _response[3]);
+    i = findCachedProperty(property);
+    if(i == SI4735_PROPERTY_CACHE) {
+        if(_propcount < SI4735_PROPERTY_CACHE) i = _propcount++;
+        else {
+            i = _propevict;
+            _propevict = (_propevict + 1) % SI4735_PROPERTY_CACHE;
+        }
+        _propcache[i][0] = property;
+    }
+    _propcache[i][1] = value;
+}
+
+byte Si4735::getArgumentCount(byte command){
+    for(byte i = 0; i < sizeof(Si4735_CMD_Args) / sizeof(Si4735_CMD_Args[0]);
+        i++)
+        if(pgm_read_byte(&Si4735_CMD_Args[i][0]) == command)
+            return pgm_read_byte(&Si4735_CMD_Args[i][1]);
+
+    //Not a command we know about, send everything we were given
+    return SI4735_CMD_MAXARGS;
 }
 
 void Si4735::enableRDS(void){
     //Enable and configure RDS reception
     if(_mode == SI4735_MODE_FM) {
-        setProperty(SI4735_PROP_FM_RDS_INT_SOURCE, word(0x00,
-                                                        SI4735_FLG_RDSRECV));
-        setProperty(SI4735_PROP_FM_RDS_INT_FIFO_COUNT, word(0x00, 0x01));
-        setProperty(SI4735_PROP_FM_RDS_CONFIG, word(SI4735_FLG_BLETHA_35 |
-                    SI4735_FLG_BLETHB_35 | SI4735_FLG_BLETHC_35 |
-                    SI4735_FLG_BLETHD_35, SI4735_FLG_RDSEN));
-    };
+        setProperties(Si4735_Profile_RDS);
+        setProperty(SI4735_PROP_FM_RDS_INT_FIFO_COUNT,
+                    word(0x00, _rdsthreshold));
+    }
+}
+
+void Si4735::completeTune(void) {
+    //poll() does all the work, including finishTune() and seek progress
+    while(poll());
 }
 
-void Si4735::waitForInterrupt(byte which){
-    while(!(getStatus() & which)){
-        //Balance being snappy with hogging the chip
-        delay(125);
-        sendCommand(SI4735_CMD_GET_INT_STATUS);
+void Si4735::waitForSTC(void) {
+    //Nobody else is waiting on us, so don't pace ourselves like poll()
+    do sendCommand(SI4735_CMD_GET_INT_STATUS);
+    while(!(getStatus() & SI4735_STATUS_STCINT));
+    switch(_mode){
+        case SI4735_MODE_FM:
+            sendCommand(SI4735_CMD_FM_TUNE_STATUS, SI4735_FLG_INTACK);
+            break;
+        case SI4735_MODE_AM:
+        case SI4735_MODE_SW:
+        case SI4735_MODE_LW:
+            sendCommand(SI4735_CMD_AM_TUNE_STATUS, SI4735_FLG_INTACK);
+            break;
     }
 }
 
-void Si4735::completeTune(void) {
-    waitForInterrupt(SI4735_STATUS_STCINT);
+void Si4735::finishTune(void) {
     //Make future off-to-on STCINT transitions visible
     switch(_mode){
         case SI4735_MODE_FM:
@@ -946,5 +2205,13 @@ void Si4735::completeTune(void) {
                 sendCommand(SI4735_CMD_AM_TUNE_STATUS, SI4735_FLG_INTACK);
             break;
     }
+    _tuning = false;
+    _seeking = false;
+    //TUNE_STATUS answers with where we ended up, INTACK or not
+    if(_tunecallback) getResponse(_response, SI4735_RSP_TUNE_STATUS);
     if(_mode == SI4735_MODE_FM) enableRDS();
+    //Last, the callback may well want to start another tune or seek
+    if(_tunecallback)
+        _tunecallback(word(_response[2], _response[3]),
+                      _response[1] & SI4735_STATUS_VALID);
 }
\ No newline at end of file
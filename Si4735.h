@@ -13,6 +13,33 @@
  * #define SI4735_NOI2C or SI4735_NOSPI to exclude I2C or SPI code; please
  * note that selecting an operation mode that has been excluded will result
  * in undefined behaviour.
+ * #define SI4735_PROPERTY_CACHE to the number of property values the driver
+ * should remember (default 16, 4 bytes of RAM each).
+ * #define SI4735_RDS_CONFIRM to the number of times every piece of PS and
+ * RadioText must be received unchanged before the RDS decoder shows it
+ * (default 2).
+ * #define SI4735_RDS_AF_MAX to the number of Alternative Frequencies the RDS
+ * decoder should remember for the current station (default and most useful
+ * maximum 25, 2 bytes of RAM each).
+ * #define SI4735_RDS_EON_MAX to the number of other networks the RDS decoder
+ * should remember EON information for (default 4) and SI4735_RDS_EON_AF_MAX
+ * to the number of AFs to keep for each (default 4); every network takes
+ * 15 bytes of RAM plus 2 per AF; 0 networks leaves EON out altogether.
+ * #define SI4735_RDS_TMC_MAX to the number of TMC messages the RDS decoder
+ * should queue (default 4, 25 bytes of RAM each); 0 leaves TMC out
+ * altogether.
+ * #define SI4735_RDS_ODA_MAX to the number of Open Data Applications the RDS
+ * decoder should remember the announcements of (default 4, 3 bytes of RAM
+ * each) and SI4735_RDS_ODA_HANDLERS to the number of ODA handlers that can
+ * be registered with it (default 2, 4 bytes of RAM each); 0 announcements
+ * leaves ODA support, RT+ included, out altogether.
+ * #define SI4735_RDS_RTPLUS_LENGTH to the longest RT+ field the RDS decoder
+ * should keep (default 32, 4 fields take that much RAM plus 12 bytes).
+ * #define SI4735_RDS_CACHE_MAX to the number of stations the RDS decoder
+ * should remember the PS and PTYN of, to show them as soon as the PI is in
+ * after tuning back (default 4, 20 bytes of RAM each). #define
+ * SI4735_RDS_CACHE_EEPROM to the EEPROM address to keep them at across
+ * power cycles (the sketch must #include <EEPROM.h> too).
  */
 
 #ifndef _SI4735_H_INCLUDED
@@ -24,6 +51,39 @@
 # include <WProgram.h>
 #endif
 
+#if !defined(SI4735_PROPERTY_CACHE)
+# define SI4735_PROPERTY_CACHE 16
+#endif
+#if !defined(SI4735_RDS_CONFIRM)
+# define SI4735_RDS_CONFIRM 2
+#endif
+#if !defined(SI4735_RDS_AF_MAX)
+# define SI4735_RDS_AF_MAX 25
+#elif SI4735_RDS_AF_MAX > 32
+# error "SI4735_RDS_AF_MAX must be 32 or less"
+#endif
+#if !defined(SI4735_RDS_EON_MAX)
+# define SI4735_RDS_EON_MAX 4
+#endif
+#if !defined(SI4735_RDS_EON_AF_MAX)
+# define SI4735_RDS_EON_AF_MAX 4
+#endif
+#if !defined(SI4735_RDS_TMC_MAX)
+# define SI4735_RDS_TMC_MAX 4
+#endif
+#if !defined(SI4735_RDS_ODA_MAX)
+# define SI4735_RDS_ODA_MAX 4
+#endif
+#if !defined(SI4735_RDS_ODA_HANDLERS)
+# define SI4735_RDS_ODA_HANDLERS 2
+#endif
+#if !defined(SI4735_RDS_RTPLUS_LENGTH)
+# define SI4735_RDS_RTPLUS_LENGTH 32
+#endif
+#if !defined(SI4735_RDS_CACHE_MAX)
+# define SI4735_RDS_CACHE_MAX 4
+#endif
+
 //Assign the default radio pin numbers (shield version)
 #define SI4735_PIN_POWER 8
 #define SI4735_PIN_RESET 9
@@ -199,6 +259,7 @@
 #define SI4735_STATUS_OVERMOD 0x04
 #define SI4735_STATUS_IALH 0x02
 #define SI4735_STATUS_IALL 0x01
+#define SI4735_STATUS_RDSSYNC 0x01
 
 //Define Si47xx Property codes
 #define SI4735_PROP_GPO_IEN word(0x0001)
@@ -340,6 +401,41 @@
 #define SI4735_RDS_DI_COMPRESSED 0x04
 #define SI4735_RDS_DI_DYNAMIC_PTY 0x08
 
+//Define RDS block error levels, as reported by the chip alongside each group
+//(see Si4735::readRDSBlock()). Use SI4735_RDS_BLE() to pick the level of
+//block 0 (A) to 3 (D) out of the packed byte.
+#define SI4735_RDS_BLE_NONE 0
+#define SI4735_RDS_BLE_12 1
+#define SI4735_RDS_BLE_35 2
+#define SI4735_RDS_BLE_UNCORRECTABLE 3
+#define SI4735_RDS_BLE(errors, block) (((errors) >> (6 - 2 * (block))) & 0x03)
+
+//Define RDS decoder events, see Si4735RDSDecoder::setEventCallback()
+#define SI4735_RDS_EVENT_PI 0x01
+#define SI4735_RDS_EVENT_PS 0x02
+#define SI4735_RDS_EVENT_RT 0x04
+#define SI4735_RDS_EVENT_CT 0x08
+#define SI4735_RDS_EVENT_TATP 0x10
+#define SI4735_RDS_EVENT_PTY 0x20
+#define SI4735_RDS_EVENT_PTYN 0x40
+#define SI4735_RDS_EVENT_AF 0x80
+
+//Define RadioText Plus fields, see Si4735RDSDecoder::getRTPlus()
+#define SI4735_RTPLUS_TITLE 0
+#define SI4735_RTPLUS_ARTIST 1
+#define SI4735_RTPLUS_ALBUM 2
+#define SI4735_RTPLUS_PROGRAMME 3
+#define SI4735_RTPLUS_FIELDS 4
+
+//Define RDS slow labelling code variants, see
+//Si4735RDSDecoder::getSlowLabel()
+#define SI4735_SLC_ECC 0
+#define SI4735_SLC_TMC 1
+#define SI4735_SLC_PAGING 2
+#define SI4735_SLC_LANGUAGE 3
+#define SI4735_SLC_BROADCASTER 6
+#define SI4735_SLC_EWS 7
+
 //This holds the current station reception metrics as given by the chip. See
 //the Si4735 datasheet for a detailed explanation of each member.
 typedef struct {
@@ -351,6 +447,28 @@ typedef struct {
     signed char FREQOFF;
 } Si4735_RX_Metrics;
 
+//This holds one entry of a property profile: a list of properties kept in
+//PROGMEM and written in one go by Si4735::setProperties(). A profile ends
+//with SI4735_PROFILE_END (property 0x0000 does not exist).
+typedef struct {
+    word property;
+    word value;
+} Si4735_Property;
+
+#define SI4735_PROFILE_END {0x0000, 0x0000}
+
+//Built-in property profiles, ready to be given to Si4735::setProperties()
+//Force FM stereo regardless of signal quality
+extern const Si4735_Property Si4735_Profile_Stereo[] PROGMEM;
+//Force FM mono regardless of signal quality
+extern const Si4735_Property Si4735_Profile_Mono[] PROGMEM;
+//Enable RDS reception (see also Si4735::setRDSThreshold())
+extern const Si4735_Property Si4735_Profile_RDS[] PROGMEM;
+//Limit seeking to the Short Wave band (2.3 - 23 MHz)
+extern const Si4735_Property Si4735_Profile_SW[] PROGMEM;
+//Limit seeking to the Long Wave band (152 - 279 kHz)
+extern const Si4735_Property Si4735_Profile_LW[] PROGMEM;
+
 //This holds time of day as received via RDS. Mimicking struct tm from
 //<time.h> for familiarity.
 //NOTE: RDS does not provide seconds, only guarantees that the minute update
@@ -367,6 +485,15 @@ typedef struct {
     byte tm_wday;
 }  Si4735_RDS_Time;
 
+//This holds a Program Item Number as received via RDS (groups 1A/1B): the
+//day of month and the UTC hour and minute the current programme was
+//scheduled to start at.
+typedef struct {
+    byte day;
+    byte hour;
+    byte minute;
+} Si4735_RDS_PIN;
+
 typedef struct {
     //PI is already taken :-(
     word programIdentifier;
@@ -377,6 +504,81 @@ typedef struct {
     char radioText[65];
 } Si4735_RDS_Data;
 
+//This holds what the RDS decoder remembers about a station it was tuned to:
+//its last confirmed PS and the PTYN it had then.
+typedef struct {
+    word frequency;
+    word programIdentifier;
+    char programService[8];
+    char programTypeName[8];
+} Si4735_RDS_Station;
+
+//This holds what EON (groups 14A/14B) tells about one other network, i.e.
+//another station run by the same broadcaster.
+typedef struct {
+    word programIdentifier;
+    bool TP, TA;
+    byte PTY;
+    char programService[9];
+    byte AFCount;
+    word AF[SI4735_RDS_EON_AF_MAX];
+} Si4735_RDS_EON;
+
+//This holds one TMC (group 8A) message, as per ISO 14819-1. Event and
+//location codes index the ISO 14819-2 event list and the location table of
+//the service sending them. Multi-group messages carry their optional
+//content raw, 28 bits to a group, for the application to pick apart.
+typedef struct {
+    word event;
+    word location;
+    byte extent;
+    bool direction, diversion;
+    byte duration;
+    byte groups;
+    unsigned long content[4];
+} Si4735_TMC_Message;
+
+//This holds one Open Data Application as announced in group 3A: the group
+//type carrying its data (type number * 2 + version, so 11A is 22; 0 if it
+//only uses 3A) and its Application IDentifier.
+typedef struct {
+    byte group;
+    word AID;
+} Si4735_RDS_ODA;
+
+//Called by the RDS decoder when something changes, with a mask of
+//SI4735_RDS_EVENT_* telling what.
+typedef void (*Si4735_RDS_Callback)(byte events);
+
+//Called by the RDS decoder with every group of an ODA, the 3A announcing it
+//included, along with the group's block error levels (see SI4735_RDS_BLE()).
+typedef void (*Si4735_RDS_ODA_Handler)(word AID, const word block[],
+                                       byte errors);
+
+//Called by the RDS decoder when another network starts or stops a traffic
+//announcement.
+typedef void (*Si4735_RDS_EON_Callback)(const Si4735_RDS_EON* network);
+
+//This holds one entry of the station table filled in by Si4735::scanBand().
+typedef struct {
+    word frequency;
+    byte RSSI;
+    byte SNR;
+    bool valid;
+} Si4735_Scan_Result;
+
+//Called when a tune or seek completes, with the frequency the chip ended up
+//on and whether it found a valid signal there.
+typedef void (*Si4735_TuneCallback)(word frequency, bool valid);
+
+//Called every now and then while a seek is in progress, with the frequency
+//the chip is currently looking at and the RSSI (in dBuV) it sees there.
+typedef void (*Si4735_SeekCallback)(word frequency, byte RSSI);
+
+//Called with each sample taken by Si4735::sweepBand(), RSSI in dBuV and SNR
+//in dB.
+typedef void (*Si4735_SweepCallback)(word frequency, byte RSSI, byte SNR);
+
 class Si4735RDSDecoder
 {
     public:
@@ -384,13 +586,48 @@ class Si4735RDSDecoder
         * Description:
         *   Default constructor.
         */
-        Si4735RDSDecoder() { resetRDS(); }
+        Si4735RDSDecoder() {
+            _eventcallback = NULL;
+#if SI4735_RDS_EON_MAX > 0
+            _eoncallback = NULL;
+#endif
+#if SI4735_RDS_ODA_MAX > 0
+            _odahandlers = 0;
+#endif
+            _cachecount = 0;
+            setBlockErrorLimits();
+            resetRDS();
+        }
 
         /*
         * Description:
         *   Decodes one RDS block and updates internal data structures.
+        * Parameters:
+        *   block - the group's four blocks, as read by readRDSBlock().
+        *   errors - the group's block error levels, as read by
+        *            readRDSBlock(). Omit to trust every block.
         */
-        void decodeRDSBlock(word block[]);
+        void decodeRDSBlock(word block[], byte errors = 0x00);
+
+        /*
+        * Description:
+        *   Sets the worst block error level (see SI4735_RDS_BLE_*) a group
+        *   may have in the blocks that carry each field and still be used
+        *   to update it. A group whose block B is uncorrectable is always
+        *   dropped, as is the PI from an uncorrectable block A.
+        * Parameters:
+        *   PS - limit for Program Service (and PTYN) characters, PIN and
+        *        slow labelling codes.
+        *   RT - limit for RadioText characters.
+        *   CT - limit for Clock Time.
+        *   AF - limit for Alternative Frequencies.
+        *   TMC - limit for Traffic Message Channel groups.
+        */
+        void setBlockErrorLimits(byte PS = SI4735_RDS_BLE_12,
+                                 byte RT = SI4735_RDS_BLE_12,
+                                 byte CT = SI4735_RDS_BLE_NONE,
+                                 byte AF = SI4735_RDS_BLE_12,
+                                 byte TMC = SI4735_RDS_BLE_NONE);
 
         /*
         * Description:
@@ -399,6 +636,199 @@ class Si4735RDSDecoder
         */
         void getRDSData(Si4735_RDS_Data* rdsdata);
 
+        /*
+        * Description:
+        *   Read-only views of the currently decoded RDS data, for when
+        *   copying all of it with getRDSData() is too much. The strings are
+        *   already printable and stay valid (but change) as more groups are
+        *   decoded.
+        */
+        word getPI(void) { return _status.programIdentifier; };
+        byte getPTY(void) { return _status.PTY; };
+        const char* getPS(void) { return _status.programService; };
+        const char* getPTYN(void) { return _status.programTypeName; };
+
+        /*
+        * Description:
+        *   Read-only view of the current RadioText, see getPS().
+        * Parameters:
+        *   length - will be set to the length of the text. Omit if you
+        *            don't care.
+        */
+        const char* getRT(byte* length = NULL) {
+            if(length) *length = _rtlength;
+            return _status.radioText;
+        };
+
+        /*
+        * Description:
+        *   Tells which fields changed since the last clearDirty(), as a mask
+        *   of SI4735_RDS_EVENT_*. resetRDS() marks them all.
+        */
+        byte getDirty(void) { return _dirty; };
+
+        /*
+        * Description:
+        *   Marks fields as seen, see getDirty().
+        * Parameters:
+        *   fields - mask of SI4735_RDS_EVENT_* to clear, omit to clear all.
+        */
+        void clearDirty(byte fields = 0xFF) { _dirty &= ~fields; };
+
+        /*
+        * Description:
+        *   Tells how many Alternative Frequencies have been received for
+        *   the current station so far, see getAF().
+        */
+        byte getAFCount(void) { return _afcount; };
+
+        /*
+        * Description:
+        *   Returns one of the Alternative Frequencies received for the
+        *   current station, in the units Si4735::setFrequency() takes:
+        *   10kHz for FM (8760 and up) and kHz for LW/MW (1602 and below).
+        *   The frequency the station is on usually shows up as well.
+        * Parameters:
+        *   index - which one, from 0 to getAFCount() - 1.
+        *   regional - will be set to true if the AF carries a regional
+        *              variant of the programme rather than the programme
+        *              itself (only ever the case with method B). Omit if
+        *              you don't care.
+        * Returns:
+        *   The frequency, or 0 if index is out of range.
+        */
+        word getAF(byte index, bool* regional = NULL);
+
+        /*
+        * Description:
+        *   Tells whether the station sends its AFs using method B (one list
+        *   per transmitter, regional variants flagged) instead of method A
+        *   (one list for the whole network).
+        */
+        bool isAFMethodB(void) { return _afmethodb; };
+
+#if SI4735_RDS_EON_MAX > 0
+        /*
+        * Description:
+        *   Tells how many other networks the current station has sent EON
+        *   information about so far, see getEON().
+        */
+        byte getEONCount(void) { return _eoncount; };
+
+        /*
+        * Description:
+        *   Read-only view of what is known about another network. PS(ON)
+        *   stays blank and AF(ON) empty until received; AFs are in getAF()
+        *   units. Once SI4735_RDS_EON_MAX networks are known, newly heard
+        *   ones replace the longest known.
+        * Parameters:
+        *   index - which one, from 0 to getEONCount() - 1.
+        * Returns:
+        *   The network or NULL if index is out of range.
+        */
+        const Si4735_RDS_EON* getEON(byte index) {
+            return (index < _eoncount) ? &_eon[index] : NULL;
+        };
+
+        /*
+        * Description:
+        *   Sets the function decodeRDSBlock() calls when another network's
+        *   TA changes, so a receiver can go over to a traffic announcement
+        *   (its AFs say where to) and come back once it's over.
+        * Parameters:
+        *   callback - function to call or NULL to disable.
+        */
+        void setEONCallback(Si4735_RDS_EON_Callback callback) {
+            _eoncallback = callback;
+        };
+#endif
+
+#if SI4735_RDS_TMC_MAX > 0
+        /*
+        * Description:
+        *   Tells how many TMC messages are waiting, see getTMCMessage().
+        */
+        byte getTMCCount(void) { return _tmccount; };
+
+        /*
+        * Description:
+        *   Takes the oldest message off the TMC queue. Messages are only
+        *   queued once whole and repeats of one still waiting replace it
+        *   rather than queue up; when the queue is full, the oldest is
+        *   dropped to make room.
+        * Parameters:
+        *   message - where to store the message.
+        * Returns:
+        *   true if there was a message, false otherwise.
+        */
+        bool getTMCMessage(Si4735_TMC_Message* message);
+#endif
+
+#if SI4735_RDS_ODA_MAX > 0
+        /*
+        * Description:
+        *   Tells how many Open Data Applications the current station has
+        *   announced so far, see getODA().
+        */
+        byte getODACount(void) { return _odacount; };
+
+        /*
+        * Description:
+        *   Read-only view of an ODA announcement. Once SI4735_RDS_ODA_MAX
+        *   are known, newly announced ones replace the longest known.
+        * Parameters:
+        *   index - which one, from 0 to getODACount() - 1.
+        * Returns:
+        *   The announcement or NULL if index is out of range.
+        */
+        const Si4735_RDS_ODA* getODA(byte index) {
+            return (index < _odacount) ? &_oda[index] : NULL;
+        };
+
+        /*
+        * Description:
+        *   Registers a decoder for an Open Data Application: from then on,
+        *   every group the station announces as carrying AID is handed to
+        *   handler, as is every 3A announcing it. Registering again for the
+        *   same AID replaces the handler.
+        * Parameters:
+        *   AID - the Application IDentifier to listen for.
+        *   handler - the function to call or NULL to unregister.
+        * Returns:
+        *   false if all SI4735_RDS_ODA_HANDLERS slots are taken.
+        */
+        bool setODAHandler(word AID, Si4735_RDS_ODA_Handler handler);
+
+        /*
+        * Description:
+        *   Read-only view of a RadioText Plus field, i.e. the part of the
+        *   current RadioText the station tagged as such. Only texts the
+        *   decoder shows (see getRT()) are ever tagged; the item fields
+        *   (title, artist, album) go blank when a new item or RadioText
+        *   starts, the programme one stays until retagged.
+        * Parameters:
+        *   field - one of SI4735_RTPLUS_*.
+        * Returns:
+        *   The field, blank if not (yet) tagged or field is out of range.
+        */
+        const char* getRTPlus(byte field) {
+            return (field < SI4735_RTPLUS_FIELDS) ? _rtplus[field] : "";
+        };
+
+        /*
+        * Description:
+        *   Tells whether the RT+ item (the song, usually) is running.
+        */
+        bool isRTPlusRunning(void) { return _rtplusrunning; };
+
+        /*
+        * Description:
+        *   Returns the RT+ item toggle, which flips every time a new item
+        *   starts. Compare against the last value to spot changes.
+        */
+        bool getRTPlusToggle(void) { return _rtplustoggle; };
+#endif
+
         /*
         * Description:
         *   Returns currently decoded RDS CT information filling a struct
@@ -411,12 +841,124 @@ class Si4735RDSDecoder
         */
         bool getRDSTime(Si4735_RDS_Time* rdstime = NULL);
 
+        /*
+        * Description:
+        *   Returns the Program Item Number of the current programme filling
+        *   a struct Si4735_RDS_PIN, if the station sends one, and returns
+        *   true; otherwise returns false and does not touch pin.
+        * Parameters:
+        *   pin - pointer to a struct Si4735_RDS_PIN to be filled with the
+        *         PIN, ignore if only interested in PIN availability.
+        */
+        bool getPIN(Si4735_RDS_PIN* pin = NULL);
+
+        /*
+        * Description:
+        *   Returns one of the slow labelling codes of group 1A, if the
+        *   station sent it, and returns true; otherwise returns false and
+        *   does not touch data.
+        * Parameters:
+        *   variant - one of SI4735_SLC_*.
+        *   data - will be set to the 12 bits of the code. Omit if only
+        *          interested in availability.
+        */
+        bool getSlowLabel(byte variant, word* data = NULL);
+
+        /*
+        * Description:
+        *   Returns the Extended Country Code, which together with the first
+        *   nibble of the PI tells which country the station is in.
+        * Returns:
+        *   The ECC or 0 if not (yet) received.
+        */
+        byte getECC(void) { return lowByte(_slc[SI4735_SLC_ECC]); };
+
+        /*
+        * Description:
+        *   Returns the code of the language the station broadcasts in, as
+        *   per IEC 62106 Annex J.
+        * Returns:
+        *   The language code or 0 (unknown) if not (yet) received.
+        */
+        byte getLanguage(void) { return lowByte(_slc[SI4735_SLC_LANGUAGE]); };
+
+        /*
+        * Description:
+        *   PS and RadioText are only copied to the Si4735_RDS_Data returned
+        *   by getRDSData() once every part of them has been received
+        *   SI4735_RDS_CONFIRM times in a row, so what's there is always a
+        *   whole, stable text (or blank). These tell whether that has
+        *   happened yet for the current station.
+        *   The one exception is a PS remembered from the last time this
+        *   station was tuned to (see SI4735_RDS_CACHE_MAX), which is shown
+        *   as soon as the PI is in and until the live one is confirmed;
+        *   isPSComplete() stays false meanwhile.
+        */
+        bool isPSComplete(void) { return _pscomplete; };
+        bool isRTComplete(void) { return _rtcomplete; };
+
+        /*
+        * Description:
+        *   Sets the function decodeRDSBlock() calls when the group it just
+        *   decoded changed something:
+        *     SI4735_RDS_EVENT_PI - PI changed;
+        *     SI4735_RDS_EVENT_PS - a new, complete PS is available;
+        *     SI4735_RDS_EVENT_RT - a new, complete RadioText is available
+        *       or RT+ fields changed;
+        *     SI4735_RDS_EVENT_CT - CT was received;
+        *     SI4735_RDS_EVENT_TATP - TA or TP changed;
+        *     SI4735_RDS_EVENT_PTY - PTY changed;
+        *     SI4735_RDS_EVENT_PTYN - PTYN changed;
+        *     SI4735_RDS_EVENT_AF - an Alternative Frequency was added.
+        *   Nothing is called for groups that change nothing, so there's no
+        *   need to poll getRDSData() to find out.
+        * Parameters:
+        *   callback - function to call or NULL to disable.
+        */
+        void setEventCallback(Si4735_RDS_Callback callback) {
+            _eventcallback = callback;
+        };
+
         /*
         * Description:
         *   Resets internal data structures, use when switching to a new
         *   station.
+        * Parameters:
+        *   frequency - the frequency just tuned to, lets the AF decoder
+        *               pick the right list when a method B network sends
+        *               several. Omit if unknown.
         */
-        void resetRDS(void);
+        void resetRDS(word frequency = 0);
+
+        /*
+        * Description:
+        *   Tells the AF decoder the same station is now received on another
+        *   frequency, e.g. after moving to one of its AFs. Unlike resetRDS(),
+        *   everything that belongs to the station (texts, AFs, EON, TMC, ...)
+        *   is kept; a method B network's list for the new frequency replaces
+        *   the one held as soon as it is received.
+        * Parameters:
+        *   frequency - the frequency just tuned to.
+        */
+        void setTunedFrequency(word frequency) { _aftuned = frequency; };
+
+#if defined(SI4735_RDS_CACHE_EEPROM)
+        /*
+        * Description:
+        *   Loads the station cache from EEPROM at SI4735_RDS_CACHE_EEPROM,
+        *   if a valid one is there.
+        */
+        void loadStationCache(void);
+
+        /*
+        * Description:
+        *   Saves the station cache to EEPROM at SI4735_RDS_CACHE_EEPROM,
+        *   only writing the bytes that changed. EEPROM wears out, so do
+        *   this at power off or every now and then rather than on every
+        *   station change.
+        */
+        void saveStationCache(void);
+#endif
 
 #if defined(SI4735_DEBUG)
         /* Description:
@@ -428,19 +970,239 @@ class Si4735RDSDecoder
     private:
         Si4735_RDS_Data _status;
         Si4735_RDS_Time _time;
-        bool _rdstextab, _rdsptynab, _havect;
+        bool _rdstextab, _rdsptynab, _havect, _pscomplete, _rtcomplete,
+             _psnew, _rtnew, _afmethodb, _aflist, _aflfmf;
+        byte _maxbleps, _maxblert, _maxblect, _maxbleaf;
+        char _psbuf[8], _rtbuf[64];
+        byte _psseen[4], _rtseen[16];
+        Si4735_RDS_Callback _eventcallback;
+        byte _rtlength, _dirty;
+        word _af[SI4735_RDS_AF_MAX], _aftuned;
+        unsigned long _afregional;
+        byte _afcount, _afheader;
+#if SI4735_RDS_EON_MAX > 0
+        Si4735_RDS_EON _eon[SI4735_RDS_EON_MAX];
+        byte _eoncount, _eonevict;
+        Si4735_RDS_EON* _eonlfmf;
+        Si4735_RDS_EON_Callback _eoncallback;
+#endif
+#if SI4735_RDS_TMC_MAX > 0
+        Si4735_TMC_Message _tmc[SI4735_RDS_TMC_MAX], _tmcmessage;
+        word _tmclast[3];
+        byte _tmccount, _tmchead, _tmcci, _tmcgsi;
+        bool _tmcassembling;
+#endif
+        byte _maxbletmc;
+#if SI4735_RDS_ODA_MAX > 0
+        Si4735_RDS_ODA _oda[SI4735_RDS_ODA_MAX];
+        byte _odacount, _odaevict, _odahandlers;
+        word _odaaid[SI4735_RDS_ODA_HANDLERS];
+        Si4735_RDS_ODA_Handler _odahandler[SI4735_RDS_ODA_HANDLERS];
+        char _rtplus[SI4735_RTPLUS_FIELDS][SI4735_RDS_RTPLUS_LENGTH + 1];
+        byte _rtplusstart[SI4735_RTPLUS_FIELDS];
+        byte _rtpluslength[SI4735_RTPLUS_FIELDS];
+        bool _rtplustoggle, _rtplusrunning, _rtshownab;
+#endif
+        Si4735_RDS_Station _cache[SI4735_RDS_CACHE_MAX];
+        byte _cachecount;
+        Si4735_RDS_PIN _pin;
+        bool _havepin;
+        word _slc[8];
+        byte _slcseen;
 #if defined(SI4735_DEBUG)
         word _rdsstats[32];
 #endif
+
+        /*
+        * Description:
+        *   Stores a freshly received piece of PS or RadioText in its receive
+        *   buffer, counting how many times in a row it came in unchanged.
+        * Parameters:
+        *   buffer - where the piece goes in the receive buffer.
+        *   seen - the piece's counter.
+        *   chars - the piece as received.
+        *   length - how many characters are in the piece.
+        * Returns:
+        *   true if the piece differs from what the buffer held before.
+        */
+        bool receiveText(char* buffer, byte* seen, const char* chars,
+                         byte length);
+
+        /*
+        * Description:
+        *   Checks whether a receive buffer is ready to be shown, i.e.
+        *   every piece of it up to the end of the text (CR or end of
+        *   buffer) has been seen SI4735_RDS_CONFIRM times.
+        * Parameters:
+        *   buffer - the receive buffer.
+        *   seen - its counters, one per piece.
+        *   count - how many pieces the buffer holds.
+        *   length - how many characters are in each piece.
+        */
+        bool isTextConfirmed(const char* buffer, const byte* seen,
+                             byte count, byte length);
+
+        /*
+        * Description:
+        *   Decodes the pair of AF codes carried in block C of group 0A,
+        *   as per RDBS §3.2.1.6, keeping track of which list and method
+        *   they belong to.
+        * Parameters:
+        *   first - the code in the high byte.
+        *   second - the code in the low byte.
+        * Returns:
+        *   true if the AF table changed.
+        */
+        bool decodeAF(byte first, byte second);
+
+        /*
+        * Description:
+        *   Adds a frequency to the AF table unless it's already there or
+        *   the table is full.
+        * Parameters:
+        *   frequency - the frequency to add, 0 is ignored.
+        *   regional - whether it carries a regional variant.
+        * Returns:
+        *   true if the AF table changed.
+        */
+        bool addAF(word frequency, bool regional);
+
+        /*
+        * Description:
+        *   Forgets every AF received so far.
+        */
+        void resetAF(void);
+
+        /*
+        * Description:
+        *   Converts an AF code to a frequency, see getAF() for units.
+        * Parameters:
+        *   code - the AF code.
+        *   lfmf - whether code follows the LF/MF filler code.
+        * Returns:
+        *   The frequency, or 0 if code isn't one.
+        */
+        word AFToFrequency(byte code, bool lfmf);
+
+#if SI4735_RDS_EON_MAX > 0
+        /*
+        * Description:
+        *   Decodes a group 14A or 14B, see RDBS §3.1.5.19.
+        * Parameters:
+        *   block - the group's four blocks.
+        *   bleC - block C's error level.
+        */
+        void decodeEON(word block[], byte bleC);
+
+        /*
+        * Description:
+        *   Looks a network up in the EON table, adding a blank entry for it
+        *   (evicting the oldest one if the table is full) if not there.
+        * Parameters:
+        *   PI - the network's PI.
+        */
+        Si4735_RDS_EON* findEON(word PI);
+#endif
+
+#if SI4735_RDS_TMC_MAX > 0
+        /*
+        * Description:
+        *   Decodes a group 8A, reassembling multi-group messages.
+        * Parameters:
+        *   block - the group's four blocks.
+        */
+        void decodeTMC(word block[]);
+
+        /*
+        * Description:
+        *   Puts a whole TMC message on the queue, see getTMCMessage().
+        */
+        void queueTMC(const Si4735_TMC_Message* message);
+#endif
+
+#if SI4735_RDS_ODA_MAX > 0
+        /*
+        * Description:
+        *   Remembers that the station sends AID's data in group, evicting
+        *   the oldest announcement if there's no room.
+        * Parameters:
+        *   group - the group type, as announced in 3A.
+        *   AID - the Application IDentifier.
+        */
+        void registerODA(byte group, word AID);
+
+        /*
+        * Description:
+        *   Looks up which ODA, if any, the station sends in group.
+        * Returns:
+        *   The AID or 0 if nobody was announced for group.
+        */
+        word findODA(byte group);
+
+        /*
+        * Description:
+        *   Hands a group to every handler registered for AID.
+        */
+        void routeODA(word AID, word block[], byte errors);
+
+        /*
+        * Description:
+        *   Decodes the two tags carried by an RT+ group.
+        * Parameters:
+        *   block - the group's four blocks.
+        * Returns:
+        *   true if any field changed.
+        */
+        bool decodeRTPlus(word block[]);
+
+        /*
+        * Description:
+        *   Copies every tagged RT+ field out of the RadioText shown.
+        * Returns:
+        *   true if any field changed.
+        */
+        bool updateRTPlus(void);
+
+        /*
+        * Description:
+        *   Blanks the title, artist and album fields and forgets their tags.
+        * Returns:
+        *   true if any of them wasn't blank.
+        */
+        bool clearRTPlusItem(void);
+#endif
+
+        /*
+        * Description:
+        *   Looks a station up in the cache and, if found, moves it to the
+        *   front (the back is where stations are evicted from).
+        * Returns:
+        *   true if found.
+        */
+        bool touchStation(word frequency, word PI);
+
+        /*
+        * Description:
+        *   Remembers the current PS and PTYN for the current frequency and
+        *   PI.
+        */
+        void storeStation(void);
         /*
         * Description:
         *   Filters the string str in place to only contain printable
-        *   characters and also replaces 0x0D (CR) with 0x00 effectively
-        *   ending the string at that point as per RDBS §3.1.5.3.
-        *   Any unprintable character is converted to a question mark ("?"),
-        *   as is customary. This helps with filtering out noisy strings.
+        *   characters. A 0x0D (CR) marks the end of the text as per
+        *   RDBS §3.1.5.3; it and everything after it are blanked with
+        *   spaces, so fixed-width fields never carry a NUL or control
+        *   character. Any other unprintable character is converted to a
+        *   question mark ("?"), as is customary. This helps with filtering
+        *   out noisy strings.
+        * Parameters:
+        *   str - the characters to filter, need not be NUL-terminated.
+        *   length - how many characters to look at.
+        * Returns:
+        *   How many characters are left before the CR, if any.
         */
-        void makePrintable(char* str);
+        byte makePrintable(char* str, byte length);
 
         /*
         * Description:
@@ -473,14 +1235,33 @@ class Si4735Translate
         /*
         * Description:
         *   Decodes the station callsign out of the PI using the method
-        *   defined in the RDBS standard for North America.
+        *   defined in the RBDS standard for North America (NRSC-4-B Annex
+        *   D), three-letter callsigns and compressed AFxx/Axxx codes
+        *   included.
         * Parameters:
         *   programIdentifier - a word containing the Program Identifier value
         *                       from RDS
         *   callSign - pointer to a char[] at least 5 characters long that
         *              receives the decoded station call sign
+        * Returns:
+        *   false (and "UNKN" in callSign) if the PI is not derived from a
+        *   callsign, e.g. because it belongs to a network.
         */
-        void decodeCallSign(word programIdentifier, char* callSign);
+        bool decodeCallSign(word programIdentifier, char* callSign);
+
+        /*
+        * Description:
+        *   Works out which country a station is in from its PI and ECC (see
+        *   Si4735RDSDecoder::getECC()).
+        * Parameters:
+        *   programIdentifier - the Program Identifier value from RDS
+        *   ECC - the Extended Country Code from RDS
+        *   country - pointer to a char[] at least 3 characters long that
+        *             receives the ISO 3166 country code
+        * Returns:
+        *   false (and a blank country) if the combination is not known.
+        */
+        bool decodeCountry(word programIdentifier, byte ECC, char* country);
 };
 
 class Si4735
@@ -534,6 +1315,22 @@ class Si4735
         */
         void begin(byte mode, bool xosc = true, bool slowshifter = true);
 
+        /*
+        * Description:
+        *   Makes the chip pulse GPO2 when it's ready for the next command
+        *   and sleeps on that edge instead of hammering the bus with status
+        *   reads. The status byte is still checked every few milliseconds in
+        *   case the edge goes missing.
+        *   Takes effect at the next power up (begin() or setMode()) and
+        *   requires GPO2 to be wired to an interrupt-capable pin; otherwise
+        *   it's ignored and CTS is polled as usual.
+        * Parameters:
+        *   enable - true to wait for CTS on GPO2, false to poll for it.
+        * Returns:
+        *   true if CTS will be waited for on GPO2.
+        */
+        bool setCTSInterrupt(bool enable = true);
+
         /*
         * Description:
         *   Used to send a command and its arguments to the radio chip.
@@ -541,11 +1338,28 @@ class Si4735
         *   command - the command byte, see datasheet and use one of the
                       SI4735_CMD_* constants
         *   arg1-7  - command arguments, see the Si4735 Programmers Guide.
+        *             Only as many of them as the command actually takes are
+        *             sent to the chip when using I2C; unknown commands get all
+        *             seven.
         */
         void sendCommand(byte command, byte arg1 = 0, byte arg2 = 0,
                          byte arg3 = 0, byte arg4 = 0, byte arg5 = 0,
                          byte arg6 = 0, byte arg7 = 0);
 
+        /*
+        * Description:
+        *   Used to send a command with an arbitrary number of arguments to
+        *   the radio chip. On I2C exactly argc argument bytes go out on the
+        *   wire, on SPI the frame is padded with zeros to the fixed 8 bytes
+        *   required by the protocol.
+        * Parameters:
+        *   command - the command byte, see datasheet and use one of the
+                      SI4735_CMD_* constants
+        *   args    - the command arguments, may be NULL if argc is 0.
+        *   argc    - number of bytes at args, at most 7.
+        */
+        void sendCommandArgs(byte command, const byte* args, byte argc);
+
         /*
         * Description:
         *   Acquires certain revision parameters from the Si4735 chip, returns
@@ -601,6 +1415,160 @@ class Si4735
         */
         void seekDown(bool wrap = true);
 
+        /*
+        * Description:
+        *   Same as setFrequency() but returns as soon as the chip has
+        *   started tuning. Call poll() until it returns false (or wait for
+        *   the tune callback) before talking to the chip about the new
+        *   frequency.
+        * Parameters:
+        *   frequency - The frequency to tune to, in kHz (or in 10kHz if using
+        *               FM mode).
+        *   fast - set to true to skip signal validation, which makes for a
+        *          quicker tune but leaves TUNE_STATUS (and getFrequency()'s
+        *          valid) meaningless.
+        */
+        void startTune(word frequency, bool fast = false);
+
+        /*
+        * Description:
+        *   Same as seekUp()/seekDown() but returns as soon as the chip has
+        *   started seeking, see startTune().
+        * Parameters:
+        *   up - true to seek up, false to seek down.
+        *   wrap - set to true to allow the seek to wrap around the current
+        *          band.
+        */
+        void startSeek(bool up = true, bool wrap = true);
+
+        /*
+        * Description:
+        *   Advances a tune or seek started with startTune()/startSeek().
+        *   Meant to be called from loop(); only talks to the chip when GPO2
+        *   went low (if CTS interrupts are enabled) or every 20ms otherwise.
+        *   Calls the tune callback when the operation completes.
+        * Returns:
+        *   true if the tune or seek is still in progress.
+        */
+        bool poll(void);
+
+        /*
+        * Description:
+        *   Checks whether a tune or seek started with startTune()/
+        *   startSeek() is still in progress.
+        */
+        bool isBusy(void) { return _tuning; };
+
+        /*
+        * Description:
+        *   Sets the function called whenever a tune or seek completes.
+        * Parameters:
+        *   callback - function to call or NULL to disable.
+        */
+        void setTuneCallback(Si4735_TuneCallback callback) {
+            _tunecallback = callback;
+        };
+
+        /*
+        * Description:
+        *   Sets the function called with seek progress each time poll()
+        *   checks on a seek that hasn't completed yet. This also applies to
+        *   seekUp()/seekDown(), which poll() under the hood, so the
+        *   callback is where a blocking seek can be cancelled from.
+        * Parameters:
+        *   callback - function to call or NULL to disable.
+        */
+        void setSeekCallback(Si4735_SeekCallback callback) {
+            _seekcallback = callback;
+        };
+
+        /*
+        * Description:
+        *   Aborts a seek in progress, leaving the chip on whatever frequency
+        *   it had got to. The tune callback is called as if the seek had
+        *   completed there. Does nothing if no seek is in progress.
+        */
+        void cancelSeek(void);
+
+        /*
+        * Description:
+        *   Walks the current band once, bottom to top, seeking from one
+        *   valid channel to the next until the chip reports it has hit the
+        *   top of the band (see the *_SEEK_BAND_* properties). Blocks until
+        *   done and leaves the radio tuned to the last entry.
+        * Parameters:
+        *   stations - where to store the station table. The first entry is
+        *              always the bottom of the band and the last may be the
+        *              top of it, check valid to tell those from stations.
+        *   size - how many entries stations can hold; the scan stops early
+        *          when it runs out of room.
+        *   duration - will be set to how long the scan took, in ms. Omit if
+        *              you don't care.
+        * Returns:
+        *   How many entries were stored in stations.
+        */
+        byte scanBand(Si4735_Scan_Result* stations, byte size,
+                      unsigned long* duration = NULL);
+
+        /*
+        * Description:
+        *   Steps through a frequency range as quickly as the chip allows,
+        *   using fast (unvalidated) tunes, and samples RSQ at each step.
+        *   Meant for band occupancy surveys rather than finding stations,
+        *   see scanBand() for that. Blocks until done and leaves the radio
+        *   tuned to the last step, tune somewhere proper afterwards.
+        * Parameters:
+        *   start - first frequency to sample, same units as setFrequency().
+        *   stop - last frequency to sample.
+        *   step - distance between samples.
+        *   callback - function to hand each sample to.
+        */
+        void sweepBand(word start, word stop, word step,
+                       Si4735_SweepCallback callback);
+
+        /*
+        * Description:
+        *   Keeps the radio on the best transmitter of the current station.
+        *   When reception drops below the given thresholds, tries each
+        *   Alternative Frequency decoder knows of with a fast tune and an
+        *   RSQ check, and stays on the first one that is clearly better and
+        *   sends the same PI; otherwise goes back where it was. Audio is
+        *   muted while looking and the whole look is time-bounded. Call it
+        *   often (e.g. from loop()): it does nothing while reception is
+        *   fine and, after a fruitless look, leaves the station alone for
+        *   a while. Moving to an AF tells decoder the new frequency (see
+        *   Si4735RDSDecoder::setTunedFrequency()) and calls the tune
+        *   callback.
+        * Parameters:
+        *   decoder - the RDS decoder fed from this radio.
+        *   RSSI - RSSI (dBuV) below which to look for a better AF.
+        *   SNR - SNR (dB) below which to look for a better AF, also the
+        *         least an AF must have to be used.
+        *   dwell - longest the audio may stay muted, in ms.
+        * Returns:
+        *   true if the radio moved to an AF.
+        */
+        bool followAF(Si4735RDSDecoder* decoder, byte RSSI = 20,
+                      byte SNR = 6, word dwell = 100);
+
+        /*
+        * Description:
+        *   Tells which station is on the current frequency by waiting for
+        *   the first trustworthy block A after a tune, rather than for a
+        *   whole PS: a block A comes every 88ms once RDS is in sync.
+        *   Anything in the RDS FIFO from before the call is thrown away.
+        *   Firmware that flags new block As lets the FIFO fill meanwhile
+        *   for readRDSBlock() to pick up; with older firmware the groups
+        *   looked at are popped and readRDSBlock() never sees them. FM
+        *   only, RDS must be enabled.
+        * Parameters:
+        *   PI - will be set to the station's PI.
+        *   timeout - how long to wait, in ms.
+        * Returns:
+        *   true if a PI came in time.
+        */
+        bool probePI(word* PI, word timeout = 200);
+
         /*
         * Description:
         *   Adjust the threshold levels of the seek function.
@@ -620,8 +1588,38 @@ class Si4735
         *   otherwise return false without side-effects.
         *   This function needs to be actively called (e.g. from loop()) in
         *   order to see sensible information.
+        * Parameters:
+        *   block - where to store the group's four blocks.
+        *   errors - will be set to the block error levels of the group,
+        *            see SI4735_RDS_BLE(). Omit if you don't care.
+        */
+        bool readRDSBlock(word* block, byte* errors = NULL);
+
+        /*
+        * Description:
+        *   Same as readRDSBlock() but empties the chip's RDS FIFO in one go
+        *   instead of stopping after the first group.
+        * Parameters:
+        *   groups - where to store the groups, oldest first.
+        *   size - how many groups fit in groups.
+        *   errors - where to store the block error levels of each group,
+        *            see SI4735_RDS_BLE(). Omit if you don't care.
+        * Returns:
+        *   How many groups were stored in groups.
         */
-        bool readRDSBlock(word* block);
+        byte readRDSGroups(word groups[][4], byte size,
+                           byte* errors = NULL);
+
+        /*
+        * Description:
+        *   Sets how many groups the chip collects in its RDS FIFO before
+        *   raising RDSINT (and thus before readRDSBlock()/readRDSGroups()
+        *   find anything to read). Higher values mean less bus traffic and
+        *   more time between reads, at the cost of latency.
+        * Parameters:
+        *   count - 1 to 25 groups, default 1.
+        */
+        void setRDSThreshold(byte count);
 
         /*
         * Description:
@@ -705,10 +1703,12 @@ class Si4735
         *   Gets the long response (long read) from the radio. Learn more
         *   about the long response in the Si4735 Datasheet.
         * Parameters:
-        *   response - A byte[] at least 16 bytes long for the response from
-        *              the radio to be stored in.
+        *   response - A byte[] at least length bytes long for the response
+        *              from the radio to be stored in.
+        *   length   - how many bytes of the response to read, at most 16.
+        *              Read only as much as you need, the rest costs bus time.
         */
-        void getResponse(byte* response);
+        void getResponse(byte* response, byte length = 16);
 
         /*
         * Description:
@@ -746,13 +1746,31 @@ class Si4735
         * Description:
         *   Sets a property value, see the SI4735_PROP_* constants and the
         *   Si4735 Datasheet for more information.
+        *   Returns as soon as the chip has taken the command; the 10ms the
+        *   datasheet gives the property to settle are only waited out if
+        *   another command (other than SET_PROPERTY) comes in before then.
+        *   Writing the value the property already has is a no-op.
         */
         void setProperty(word property, word value);
 
+        /*
+        * Description:
+        *   Writes a whole property profile, see Si4735_Property and the
+        *   Si4735_Profile_* tables. Properties that already hold the wanted
+        *   value are skipped and the settle time is paid once at the end
+        *   rather than once per property.
+        * Parameters:
+        *   profile - pointer to a PROGMEM array of Si4735_Property,
+        *             terminated by SI4735_PROFILE_END.
+        */
+        void setProperties(const Si4735_Property* profile);
+
         /*
         * Description:
         *   Gets a property value, see the SI4735_PROP_* constants and the
         *   Si4735 Datasheet for more information.
+        *   Values written or read since the last power up are remembered
+        *   and served without talking to the chip.
         * Returns:
         *   The current value of property.
         */
@@ -761,8 +1779,57 @@ class Si4735
     private:
         byte _pinPower, _pinReset, _pinGPO2, _pinSDIO, _pinGPO1, _pinSCLK,
              _pinSEN;
-        byte _mode, _response[16], _i2caddr;
-        bool _haverds;
+        byte _mode, _response[16], _i2caddr, _rdsthreshold;
+        bool _haverds, _ctsint, _propsettling, _tuning, _seeking, _afwait;
+        static volatile bool _gpo2int;
+        unsigned long _propset, _tunepoll, _afsearch;
+        Si4735_TuneCallback _tunecallback;
+        Si4735_SeekCallback _seekcallback;
+        word _propcache[SI4735_PROPERTY_CACHE][2];
+        byte _propcount, _propevict;
+
+        /*
+        * Description:
+        *   GPO2 interrupt handler, just takes note that the line went low.
+        */
+        static void handleGPO2(void) { _gpo2int = true; };
+
+        /*
+        * Description:
+        *   Waits for CTS to come back up after a command has been sent.
+        * Returns:
+        *   The status byte that had CTS set.
+        */
+        byte waitForCTS(void);
+
+        /*
+        * Description:
+        *   Looks property up in the property cache.
+        * Returns:
+        *   Index of property in _propcache or SI4735_PROPERTY_CACHE if we
+        *   don't know its value.
+        */
+        byte findCachedProperty(word property);
+
+        /*
+        * Description:
+        *   Remembers value for property, evicting the oldest entry in the
+        *   property cache if it's full.
+        */
+        void cacheProperty(word property, word value);
+
+        /*
+        * Description:
+        *   Waits for the last SET_PROPERTY to settle, if it hasn't already.
+        */
+        void waitForProperty(void);
+
+        /*
+        * Description:
+        *   Looks up how many argument bytes command takes, according to the
+        *   Si4735 Programmers Guide.
+        */
+        byte getArgumentCount(byte command);
 
         /*
         * Description:
@@ -772,17 +1839,37 @@ class Si4735
 
         /*
         * Description:
-        *   Waits for completion of various operations.
+        *   Pulls the oldest group off the chip's RDS FIFO.
         * Parameters:
-        *   which - interrupt flag to wait for, see SI4735_STATUS_*
+        *   block - where to store the group's four blocks.
+        *   errors - where to store the group's block error levels, if not
+        *            NULL.
+        * Returns:
+        *   How many groups are left in the FIFO.
         */
-        void waitForInterrupt(byte which);
+        byte fetchRDSGroup(word* block, byte* errors);
 
         /*
         * Description:
-        *   Performs actions common to all tuning modes.
+        *   Waits for a tune or seek to complete and performs actions common
+        *   to all tuning modes.
         */
         void completeTune(void);
+
+        /*
+        * Description:
+        *   Acknowledges STC once a tune or seek is known to be complete and
+        *   tells the tune callback about it.
+        */
+        void finishTune(void);
+
+        /*
+        * Description:
+        *   Waits for STC as fast as possible (no pacing, no callbacks) and
+        *   acknowledges it. The TUNE_STATUS response is left for
+        *   getResponse() to pick up.
+        */
+        void waitForSTC(void);
 };
 
 #endif
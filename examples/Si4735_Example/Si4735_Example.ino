@@ -68,7 +68,7 @@ Si4735 radio;
 Si4735RDSDecoder decoder;
 //Other variables we will use below
 char command;
-byte mode, status;
+byte mode, status, rdserrors;
 word frequency, rdsblock[4];
 bool goodtune;
 Si4735_RX_Metrics RSQ;
@@ -92,7 +92,8 @@ void loop()
   //Attempt to update RDS information if any surfaced
   if(!(millis() % 250)) {
     radio.sendCommand(SI4735_CMD_GET_INT_STATUS);
-    if(radio.readRDSBlock(rdsblock)) decoder.decodeRDSBlock(rdsblock);
+    if(radio.readRDSBlock(rdsblock, &rdserrors))
+      decoder.decodeRDSBlock(rdsblock, rdserrors);
   }
   
   //Wait until a character comes in on the Serial port.
@@ -101,13 +102,15 @@ void loop()
     command = Serial.read();
     switch(command){
       case 'v': 
-        if(radio.volumeDown()) Serial.println(F("Volume decreased"));
-        else Serial.println(F("ERROR: already at minimum volume"));
+        if(radio.volumeDown()) Serial.print(F("Volume decreased to "));
+        else Serial.print(F("ERROR: already at minimum volume "));
+        Serial.println(radio.getVolume());
         Serial.flush();
         break;
       case 'V':
-        if(radio.volumeUp()) Serial.println(F("Volume increased"));
-        else Serial.println(F("ERROR: already at maximum volume"));
+        if(radio.volumeUp()) Serial.print(F("Volume increased to "));
+        else Serial.print(F("ERROR: already at maximum volume "));
+        Serial.println(radio.getVolume());
         Serial.flush();
         break;
       case 's': 